@@ -0,0 +1,170 @@
+#include "AsyncWriter.h"
+#include "TimeSpec.h"
+#include "definitions.h"
+
+#include <algorithm>
+#include <iostream>
+#include <cassert>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <sys/uio.h>
+
+/// initial size of the staging buffer, grows on demand
+static const size_t initialStagingSize = 64 * 1024;
+
+AsyncWriter::AsyncWriter(const int fileDescriptor, const WriterPolicy& writerPolicy) :
+  std::streambuf(), fd(fileDescriptor), policy(writerPolicy), staging(initialStagingSize),
+  ring(writerPolicy.capacity), head(0), tail(0), stop(false), failed(false), overruns(0),
+  dataSem(), spaceSem(), thread() {
+    assert(!ring.empty());
+
+    setp(&staging[0], &staging[0] + staging.size());
+    sem_init(&dataSem,  0, 0);
+    sem_init(&spaceSem, 0, 0);
+
+    const int err = pthread_create(&thread, NULL, threadMain, this);
+    if (err != 0) {
+        std::cerr << "could not create writer thread: " << strerror(err) << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+AsyncWriter::~AsyncWriter() {
+    sync();
+
+    __sync_synchronize();
+    stop = true;
+    sem_post(&dataSem);
+    pthread_join(thread, NULL);
+
+    sem_destroy(&dataSem);
+    sem_destroy(&spaceSem);
+}
+
+AsyncWriter::int_type AsyncWriter::overflow(int_type c) {
+    const size_t used = pptr() - pbase();
+    staging.resize(staging.size() * 2);
+    setp(&staging[0], &staging[0] + staging.size());
+    pbump(used);
+
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+    return traits_type::not_eof(c);
+}
+
+int AsyncWriter::sync() {
+    const char* data = pbase();
+    size_t len = pptr() - pbase();
+    setp(&staging[0], &staging[0] + staging.size());
+    if (len == 0) return 0;
+
+    if (likely(len <= ring.size() - pending())) {
+        push(data, len);
+    } else if (policy.overflow == WriterPolicy::OverflowBlock) {
+        // push piece by piece as soon as the writer thread has made room
+        while (len > 0) {
+            const size_t space = ring.size() - pending();
+            if (space == 0) {
+                sem_post(&dataSem);
+                while (sem_wait(&spaceSem) == -1 && errno == EINTR) {}
+                continue;
+            }
+            const size_t chunk = std::min(len, space);
+            push(data, chunk);
+            data += chunk;
+            len  -= chunk;
+        }
+    } else {
+        ++overruns;
+        return 0;
+    }
+
+    if (policy.flush == WriterPolicy::FlushTick ||
+        (policy.flush == WriterPolicy::FlushBytes && pending() >= policy.flushBytes)) {
+        sem_post(&dataSem);
+    }
+
+    return 0;
+}
+
+void* AsyncWriter::threadMain(void* arg) {
+    AsyncWriter& writer = *static_cast<AsyncWriter*>(arg);
+
+    for (;;) {
+        if (writer.policy.flush == WriterPolicy::FlushTime) {
+            TimeSpec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline.ts); // sem_timedwait() requires CLOCK_REALTIME
+            deadline += TimeSpec(writer.policy.flushSecs);
+            while (sem_timedwait(&writer.dataSem, &deadline.ts) == -1 && errno == EINTR) {}
+        } else {
+            while (sem_wait(&writer.dataSem) == -1 && errno == EINTR) {}
+        }
+
+        // everything pushed before stop has been set is written below
+        const bool last = writer.stop;
+        __sync_synchronize();
+        writer.writeAvailable();
+        if (last)
+            break;
+    }
+
+    return NULL;
+}
+
+void AsyncWriter::push(const char* data, size_t len) {
+    assert(len <= ring.size() - pending());
+
+    const size_t pos   = head % ring.size();
+    const size_t first = std::min(len, ring.size() - pos);
+    memcpy(&ring[pos], data, first);
+    memcpy(&ring[0], data + first, len - first);
+
+    // publishes the data to the writer thread
+    __sync_fetch_and_add(&head, len);
+}
+
+void AsyncWriter::writeAvailable() {
+    for (;;) {
+        const size_t len = pending();
+        __sync_synchronize(); // read head before the data it covers
+        if (len == 0)
+            break;
+
+        // a single write for all available data, two pieces if it wraps around
+        const size_t pos   = tail % ring.size();
+        const size_t first = std::min(len, ring.size() - pos);
+        struct iovec iov[2];
+        iov[0].iov_base = &ring[pos];
+        iov[0].iov_len  = first;
+        iov[1].iov_base = &ring[0];
+        iov[1].iov_len  = len - first;
+
+        ssize_t written = len;
+        if (likely(!failed)) {
+            written = writev(fd, iov, iov[1].iov_len ? 2 : 1);
+            if (unlikely(written == -1)) {
+                if (errno == EINTR) continue;
+                std::cerr << "could not write output, discarding further output: " << strerror(errno) << std::endl;
+                failed  = true;
+                written = len;
+            }
+        }
+
+        // frees the space to the producer
+        __sync_fetch_and_add(&tail, written);
+
+        if (policy.overflow == WriterPolicy::OverflowBlock) {
+            int waiting = 0;
+            sem_getvalue(&spaceSem, &waiting);
+            if (waiting == 0) sem_post(&spaceSem);
+        }
+    }
+}
+
+size_t AsyncWriter::pending() const {
+    return head - tail;
+}
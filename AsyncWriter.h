@@ -0,0 +1,91 @@
+#ifndef ASYNC_WRITER_H
+#define ASYNC_WRITER_H ASYNC_WRITER_H
+
+#include <streambuf>
+#include <vector>
+#include <cstddef>
+
+#include <pthread.h>
+#include <semaphore.h>
+
+/// configuration of an @ref AsyncWriter
+struct WriterPolicy {
+    /// when the writer thread writes buffered data
+    enum Flush {
+        FlushTick,  ///< after each tick, i.e. each time the stream is flushed
+        FlushBytes, ///< as soon as at least @ref flushBytes bytes are buffered
+        FlushTime   ///< every @ref flushSecs seconds
+    };
+
+    /// what happens to a tick's output if it doesn't fit into the buffer
+    enum Overflow {
+        OverflowBlock, ///< wait until the writer thread has made room
+        OverflowDrop,  ///< silently drop it
+        OverflowCount  ///< drop it, report the number of overruns on exit
+    };
+
+    WriterPolicy() : flush(FlushTick), flushBytes(0), flushSecs(0.0),
+                     overflow(OverflowCount), capacity(4 * 1024 * 1024) {}
+
+    Flush    flush;
+    size_t   flushBytes; ///< used by FlushBytes
+    double   flushSecs;  ///< used by FlushTime
+    Overflow overflow;
+    size_t   capacity;   ///< size of the ring buffer in bytes
+};
+
+/// stream buffer handing its data to a dedicated writer thread
+/// @note output is staged until the stream is flushed (once per tick), staged data is then
+///       copied as a whole into a single-producer single-consumer ring buffer, so the output
+///       of a tick is either written or dropped completely
+/// @note the writer thread issues one write() for all data available in the ring buffer
+class AsyncWriter : public std::streambuf {
+  public:
+    /// starts a writer thread writing to @p fd, doesn't take ownership of @p fd
+    AsyncWriter(const int fd, const WriterPolicy& policy);
+
+    /// writes all remaining data and stops the writer thread
+    ~AsyncWriter();
+
+    /// returns the number of ticks dropped because the buffer was full
+    unsigned long getOverruns() const { return overruns; }
+
+  protected:
+    /// grows the staging buffer
+    int_type overflow(int_type c);
+
+    /// moves the staged data into the ring buffer
+    int sync();
+
+  private:
+    // not copyable, owns the thread
+    AsyncWriter(const AsyncWriter& other);
+    AsyncWriter& operator=(const AsyncWriter& other);
+
+    /// thread main function
+    static void* threadMain(void* arg);
+
+    /// copies @p len bytes into the ring buffer, caller has to ensure enough free space
+    void push(const char* data, size_t len);
+
+    /// writes everything available in the ring buffer, called by the writer thread
+    void writeAvailable();
+
+    /// returns the number of bytes in the ring buffer
+    size_t pending() const;
+
+    const int          fd;       ///< file descriptor to write to
+    const WriterPolicy policy;   ///< flush and overflow policy
+    std::vector<char>  staging;  ///< output of the current tick, only accessed by the producer
+    std::vector<char>  ring;     ///< ring buffer between producer and writer thread
+    volatile size_t    head;     ///< total bytes pushed, only written by the producer
+    volatile size_t    tail;     ///< total bytes written, only written by the writer thread
+    volatile bool      stop;     ///< writer thread shall write remaining data and terminate
+    bool               failed;   ///< writing failed, data is discarded from now on
+    unsigned long      overruns; ///< number of dropped ticks
+    sem_t              dataSem;  ///< posted by the producer when the writer thread shall write
+    sem_t              spaceSem; ///< posted by the writer thread after it has made room
+    pthread_t          thread;   ///< writer thread
+};
+
+#endif // ASYNC_WRITER_H
@@ -0,0 +1,210 @@
+/*      Benchmark.cpp
+ *
+ *      microbenchmarks of the parsers, the cache and the CSV output, followed by
+ *      end-to-end runs of audria on synthetic /proc trees created by audria-procgen,
+ *      run via 'make bench'
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ */
+
+#include "helper.h"
+#include "Output.h"
+#include "ProcCache.h"
+#include "ProcFile.h"
+#include "ProcParser.h"
+#include "ProcReader.h"
+#include "TimeSpec.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+// number of processes of the synthetic /proc trees for the end-to-end runs
+static const int processCounts[] = {100, 1000, 10000};
+
+// number of processes whose files are used for the microbenchmarks
+static const int microProcesses = 100;
+
+// minimum duration of each microbenchmark in seconds
+static const double microSecs = 0.5;
+
+/// results of benchmarked code are stored here to keep the compiler from optimizing it away
+volatile unsigned long benchSink;
+
+/// returns the current time in seconds
+double now() {
+    TimeSpec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts.ts);
+    return ts.seconds();
+}
+
+/// contents of a single file from /proc
+struct FileContent {
+    FileContent(const std::string& path) : data() {
+        ProcFile file(path);
+        ReadBuffer buffer;
+        const ssize_t len = file.read(buffer);
+        if (len <= 0) {
+            std::cerr << "could not read " << path << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        data.assign(&buffer[0], len);
+    }
+
+    std::string data;
+};
+
+typedef bool (*Parser)(const char* buf, const size_t len, ProcessStatus& status);
+
+/// runs @p parser on all @p files repeatedly and prints the time per file
+void benchParser(const char* name, Parser parser, const std::vector<FileContent>& files) {
+    ProcessStatus status;
+    unsigned long calls = 0;
+    const double start = now();
+    double elapsed;
+    do {
+        for (size_t i = 0; i < files.size(); ++i) {
+            parser(files[i].data.c_str(), files[i].data.size(), status);
+        }
+        calls += files.size();
+        elapsed = now() - start;
+    } while (elapsed < microSecs);
+
+    std::cout << std::left << std::setw(28) << name << std::right << std::setw(10)
+              << elapsed / calls * 1e9 << " ns/call" << std::endl;
+}
+
+/// benchmarks the construction of a Cache from parsed status values
+void benchCache(const std::vector<ProcessStatus>& statuses) {
+    unsigned long calls = 0;
+    const double start = now();
+    double elapsed;
+    do {
+        for (size_t i = 0; i < statuses.size(); ++i) {
+            const Cache cache(statuses[i]);
+            benchSink = cache.userTimeJiffies;
+        }
+        calls += statuses.size();
+        elapsed = now() - start;
+    } while (elapsed < microSecs);
+
+    std::cout << std::left << std::setw(28) << "Cache construction" << std::right << std::setw(10)
+              << elapsed / calls * 1e9 << " ns/call" << std::endl;
+}
+
+/// benchmarks writing rows with all columns in CSV format
+void benchCsvOutput(const std::vector<ProcessStatus>& statuses) {
+    std::ostringstream os;
+    CsvOutput output(os, std::set<int>());
+    const TimeSpec ts(12345, 678901234);
+    unsigned long calls = 0;
+    const double start = now();
+    double elapsed;
+    do {
+        os.str("");
+        for (size_t i = 0; i < statuses.size(); ++i) {
+            output.writeRow(ts, statuses[i]);
+        }
+        calls += statuses.size();
+        elapsed = now() - start;
+    } while (elapsed < microSecs);
+
+    std::cout << std::left << std::setw(28) << "CsvOutput::writeRow" << std::right << std::setw(10)
+              << elapsed / calls * 1e9 << " ns/call" << std::endl;
+}
+
+/// runs audria with the given arguments on @p root and prints the number of iterations per second
+void benchAudria(const std::string& root, const int processes, const std::string& args) {
+    // aim for roughly 200000 processes read in total,
+    // warnings about the interval being below the kernel tick rate are expected
+    const int iterations = std::max(10, 200000 / processes);
+    const std::string cmd = "./audria -p " + root + " -a -d 0 -n " + numberToString(iterations) +
+                            " -o /dev/null " + args + " 2>/dev/null";
+
+    const double start = now();
+    if (system(cmd.c_str()) != 0) {
+        std::cerr << "failed to run '" << cmd << "'" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    const double elapsed = now() - start;
+
+    std::cout << std::left << std::setw(8) << processes << std::setw(36) << (args.empty() ? "(default)" : args)
+              << std::right << std::setw(10) << iterations / elapsed << " iterations/s"
+              << std::setw(12) << iterations * processes / elapsed << " processes/s" << std::endl;
+}
+
+int main() {
+    char tmpl[] = "/tmp/audria-bench.XXXXXX";
+    const char* tmpDir = mkdtemp(tmpl);
+    if (!tmpDir) {
+        std::cerr << "could not create temporary directory: " << strerror(errno) << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<std::string> roots;
+    for (unsigned int i = 0; i < sizeof(processCounts) / sizeof(processCounts[0]); ++i) {
+        roots.push_back(std::string(tmpDir) + "/proc-" + numberToString(processCounts[i]));
+        const std::string cmd = "./audria-procgen " + roots.back() + " " + numberToString(processCounts[i]);
+        if (system(cmd.c_str()) != 0) {
+            std::cerr << "failed to run '" << cmd << "'" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::cout << std::fixed << std::setprecision(1);
+
+    // microbenchmarks on the files of the smallest tree
+    std::vector<FileContent> stats, statuses, ios, schedStats;
+    for (int pid = 1000; pid < 1000 + microProcesses; ++pid) {
+        const std::string dir = roots[0] + "/" + numberToString(pid);
+        stats.push_back(FileContent(dir + "/stat"));
+        statuses.push_back(FileContent(dir + "/status"));
+        ios.push_back(FileContent(dir + "/io"));
+        schedStats.push_back(FileContent(dir + "/schedstat"));
+    }
+
+    std::cout << "# microbenchmarks" << std::endl;
+    benchParser("ProcParser::parseStat",   ProcParser::parseStat,   stats);
+    benchParser("ProcParser::parseStatus", ProcParser::parseStatus, statuses);
+    benchParser("ProcParser::parseIO",     ProcParser::parseIO,     ios);
+    benchParser("ProcParser::parseSchedStat", ProcParser::parseSchedStat, schedStats);
+
+    std::vector<ProcessStatus> parsed(microProcesses);
+    for (int i = 0; i < microProcesses; ++i) {
+        ProcParser::parseStat(stats[i].data.c_str(), stats[i].data.size(), parsed[i]);
+        ProcParser::parseStatus(statuses[i].data.c_str(), statuses[i].data.size(), parsed[i]);
+        ProcParser::parseIO(ios[i].data.c_str(), ios[i].data.size(), parsed[i]);
+        ProcParser::parseSchedStat(schedStats[i].data.c_str(), schedStats[i].data.size(), parsed[i]);
+    }
+    benchCache(parsed);
+    benchCsvOutput(parsed);
+
+    std::cout << "# end-to-end" << std::endl;
+    for (unsigned int i = 0; i < roots.size(); ++i) {
+        benchAudria(roots[i], processCounts[i], "");
+        benchAudria(roots[i], processCounts[i], "-u");
+        benchAudria(roots[i], processCounts[i], "-j 4");
+        benchAudria(roots[i], processCounts[i], "-f Name,CurCPUPerc");
+        benchAudria(roots[i], processCounts[i], "-A schedstat -f Name,CurCPUPerc");
+        benchAudria(roots[i], processCounts[i], "-D heartbeat=60");
+        benchAudria(roots[i], processCounts[i], "-t 10");
+    }
+
+    const std::string cleanup = std::string("rm -rf ") + tmpDir;
+    return system(cleanup.c_str()) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,355 @@
+#include "CompressedFormat.h"
+
+#include <cstring>
+
+/// maps signed to unsigned integers so that small magnitudes get short varints
+/// @note takes the two's complement bits of the difference of two unsigned values
+static uint64_t zigzag(const uint64_t value) {
+    return (value << 1) ^ -(value >> 63);
+}
+
+/// inverse of @ref zigzag()
+static uint64_t unzigzag(const uint64_t value) {
+    return (value >> 1) ^ -(value & 1);
+}
+
+/// appends @p value as varint, 7 bits per byte starting with the lowest, the highest bit marks further bytes
+static void putVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out += (char)(value | 0x80);
+        value >>= 7;
+    }
+    out += (char)value;
+}
+
+/// reads a varint written by @ref putVarint()
+/// @return false if the input ends early or the varint is too long
+static bool getVarint(std::streambuf& in, uint64_t& value) {
+    value = 0;
+    for (unsigned int shift = 0; shift < 64; shift += 7) {
+        const int byte = in.sbumpc();
+        if (byte == std::streambuf::traits_type::eof()) return false;
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+/// returns the bits of a double
+static uint64_t doubleBits(const double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+/// appends bits to a string, highest bit first, the last byte is padded with zeros by @ref flush()
+class BitWriter {
+  public:
+    BitWriter(std::string& output) : out(output), current(0), used(0) {}
+
+    /// appends the lowest @p bits bits of @p value, at most 64
+    void write(const uint64_t value, const unsigned int bits) {
+        for (unsigned int bit = bits; bit > 0; --bit) {
+            current = (current << 1) | ((value >> (bit - 1)) & 1);
+            if (++used == 8) {
+                out += (char)current;
+                current = 0;
+                used = 0;
+            }
+        }
+    }
+
+    /// appends the last partial byte
+    void flush() {
+        if (used == 0) return;
+        out += (char)(current << (8 - used));
+        current = 0;
+        used = 0;
+    }
+
+  private:
+    std::string& out;     ///< string to append to
+    unsigned int current; ///< bits of the partial byte
+    unsigned int used;    ///< number of bits in @ref current
+};
+
+/// reads bits written by @ref BitWriter
+class BitReader {
+  public:
+    BitReader(std::streambuf& input) : in(input), current(0), left(0) {}
+
+    /// reads @p bits bits, at most 64, into @p value
+    /// @return false if the input ends early
+    bool read(uint64_t& value, const unsigned int bits) {
+        value = 0;
+        for (unsigned int bit = 0; bit < bits; ++bit) {
+            if (left == 0) {
+                const int byte = in.sbumpc();
+                if (byte == std::streambuf::traits_type::eof()) return false;
+                current = byte;
+                left = 8;
+            }
+            --left;
+            value = (value << 1) | ((current >> left) & 1);
+        }
+        return true;
+    }
+
+  private:
+    std::streambuf& in;   ///< buffer to read from
+    unsigned int current; ///< last byte read
+    unsigned int left;    ///< number of bits of @ref current not read yet
+};
+
+/// marks a real column without a previous XOR window
+static const uint8_t noWindow = 0xff;
+
+CompressedSeries::CompressedSeries(const std::vector<int>& outColumns) :
+  columns(outColumns), state(), rows(0), lastTimeNs(0) {
+}
+
+void CompressedSeries::reset() {
+    state.clear();
+    rows = 0;
+    lastTimeNs = 0;
+}
+
+uint64_t CompressedSeries::seriesKey(const unsigned char tag, const int64_t pid, const int64_t tid) {
+    // PIDs and TIDs fit into 31 bits (PID_MAX_LIMIT is 2^22)
+    return ((uint64_t)(pid & 0x7fffffff) << 32) | ((uint64_t)(tid & 0x7fffffff) << 1)
+         | ((tag & CompressedFormat::flagTree) ? 1 : 0);
+}
+
+CompressedSeries::Series& CompressedSeries::series(const uint64_t key) {
+    const SeriesMap::iterator seriesIt = state.find(key);
+    if (seriesIt != state.end()) return seriesIt->second;
+
+    Series& added = state[key];
+    added.timeNs = lastTimeNs;
+    added.values.resize(columns.size(), StatusValue());
+    added.deltas.resize(columns.size(), 0);
+    added.leading.resize(columns.size(), noWindow);
+    added.trailing.resize(columns.size(), 0);
+    return added;
+}
+
+void CompressedSeries::countRow(const uint64_t timeNs) {
+    lastTimeNs = timeNs;
+    if (++rows < CompressedFormat::purgeRows) return;
+
+    rows = 0;
+    const uint64_t maxAgeNs = (uint64_t)(CompressedFormat::purgeAgeSecs * TimeSpec::secInNsec);
+    for (SeriesMap::iterator seriesIt = state.begin(); seriesIt != state.end(); ) {
+        if (seriesIt->second.timeNs + maxAgeNs < timeNs) {
+            state.erase(seriesIt++);
+        } else {
+            ++seriesIt;
+        }
+    }
+}
+
+CompressedEncoder::CompressedEncoder(const std::vector<int>& outColumns) : CompressedSeries(outColumns) {
+}
+
+void CompressedEncoder::encode(const TimeSpec& ts, const ProcessStatus& status, std::string& out) {
+    using namespace CompressedFormat;
+
+    const uint64_t timeNs = (uint64_t)ts.ts.tv_sec * TimeSpec::secInNsec + ts.ts.tv_nsec;
+    const int64_t pid = status.isValid(PID) ? status.values[PID].i : 0;
+    const int64_t tid = status.isValid(TID) ? status.values[TID].i : 0;
+
+    unsigned char tag = recordTag;
+    if (status.isValid(TID))       tag |= flagTID;
+    if (status.isValid(Processes)) tag |= flagTree;
+    Series& last = series(seriesKey(tag, pid, tid));
+
+    uint64_t valid = 0;
+    bool nameChanged = false;
+    for (unsigned int i = 0; i < columns.size(); ++i) {
+        if (!status.isValid(columns[i])) continue;
+        valid |= (uint64_t)1 << i;
+        if (statusColumnType[columns[i]] == ColumnText) {
+            nameChanged = last.name != status.name;
+        }
+    }
+    if (valid != last.valid) tag |= flagValid;
+    if (nameChanged)         tag |= flagName;
+
+    out += (char)tag;
+    putVarint(out, zigzag(pid));
+    if (tag & flagTID) putVarint(out, zigzag(tid));
+
+    // differences are taken modulo 2^64, wrapping around like the counters themselves
+    const uint64_t timeDeltaNs = timeNs - last.timeNs;
+    putVarint(out, zigzag(timeDeltaNs - last.timeDeltaNs));
+    last.timeNs      = timeNs;
+    last.timeDeltaNs = timeDeltaNs;
+
+    if (tag & flagValid) {
+        putVarint(out, valid ^ last.valid);
+        last.valid = valid;
+    }
+    if (tag & flagName) {
+        last.name = status.name;
+        putVarint(out, last.name.size());
+        out += last.name;
+    }
+
+    for (unsigned int i = 0; i < columns.size(); ++i) {
+        const int column = columns[i];
+        if ((valid & ((uint64_t)1 << i)) == 0 || column == PID || column == TID) continue;
+
+        const StatusValue& value = status.values[column];
+        switch (statusColumnType[column]) {
+            case ColumnCounter: {
+                const uint64_t delta = value.u - last.values[i].u;
+                putVarint(out, zigzag(delta - last.deltas[i]));
+                last.deltas[i] = delta;
+                last.values[i] = value;
+                break;
+            }
+            case ColumnChar:
+            case ColumnInteger:
+                putVarint(out, zigzag(value.u - last.values[i].u));
+                last.values[i] = value;
+                break;
+            default:
+                break;
+        }
+    }
+
+    // reals as in Gorilla: '0' for an unchanged value, '10' followed by the bits within the previous window
+    // of leading and trailing zeros of the XOR, '11' followed by a new window and the bits within it
+    BitWriter bits(out);
+    for (unsigned int i = 0; i < columns.size(); ++i) {
+        if ((valid & ((uint64_t)1 << i)) == 0 || statusColumnType[columns[i]] != ColumnReal) continue;
+
+        const uint64_t value = doubleBits(status.values[columns[i]].d);
+        const uint64_t xorBits = value ^ last.values[i].u;
+        last.values[i].u = value;
+        if (xorBits == 0) {
+            bits.write(0, 1);
+            continue;
+        }
+
+        unsigned int leading = __builtin_clzll(xorBits);
+        const unsigned int trailing = __builtin_ctzll(xorBits);
+        if (leading > 31) leading = 31;
+        if (last.leading[i] != noWindow && leading >= last.leading[i] && trailing >= last.trailing[i]) {
+            bits.write(2, 2);
+            bits.write(xorBits >> last.trailing[i], 64 - last.leading[i] - last.trailing[i]);
+        } else {
+            const unsigned int length = 64 - leading - trailing;
+            bits.write(3, 2);
+            bits.write(leading, 5);
+            bits.write(length - 1, 6);
+            bits.write(xorBits >> trailing, length);
+            last.leading[i]  = leading;
+            last.trailing[i] = trailing;
+        }
+    }
+    bits.flush();
+
+    countRow(timeNs);
+}
+
+CompressedDecoder::CompressedDecoder(const std::vector<int>& outColumns) : CompressedSeries(outColumns) {
+}
+
+bool CompressedDecoder::decode(std::istream& in, TimeSpec& ts, ProcessStatus& status) {
+    using namespace CompressedFormat;
+
+    std::streambuf& buf = *in.rdbuf();
+    const int tag = buf.sbumpc();
+    if (tag == std::streambuf::traits_type::eof() || (tag & ~0x0f) != recordTag) return false;
+
+    uint64_t encoded = 0;
+    if (!getVarint(buf, encoded)) return false;
+    const int64_t pid = (int64_t)unzigzag(encoded);
+    int64_t tid = 0;
+    if (tag & flagTID) {
+        if (!getVarint(buf, encoded)) return false;
+        tid = (int64_t)unzigzag(encoded);
+    }
+    Series& last = series(seriesKey(tag, pid, tid));
+
+    if (!getVarint(buf, encoded)) return false;
+    last.timeDeltaNs += unzigzag(encoded);
+    last.timeNs      += last.timeDeltaNs;
+
+    if (tag & flagValid) {
+        if (!getVarint(buf, encoded)) return false;
+        last.valid ^= encoded;
+        if (columns.size() < 64 && (last.valid >> columns.size()) != 0) return false;
+    }
+    if (tag & flagName) {
+        if (!getVarint(buf, encoded) || encoded >= maxNameLength) return false;
+        char name[maxNameLength];
+        if (buf.sgetn(name, encoded) != (std::streamsize)encoded) return false;
+        last.name.assign(name, encoded);
+    }
+
+    ts = TimeSpec(last.timeNs / TimeSpec::secInNsec, last.timeNs % TimeSpec::secInNsec);
+    status = ProcessStatus();
+    for (unsigned int i = 0; i < columns.size(); ++i) {
+        const int column = columns[i];
+        if ((last.valid & ((uint64_t)1 << i)) == 0) continue;
+
+        status.setValid(column);
+        if (column == PID) {
+            status.values[column].i = pid;
+            continue;
+        }
+        if (column == TID) {
+            status.values[column].i = tid;
+            continue;
+        }
+        switch (statusColumnType[column]) {
+            case ColumnText:
+                memcpy(status.name, last.name.c_str(), last.name.size() + 1);
+                break;
+            case ColumnCounter:
+                if (!getVarint(buf, encoded)) return false;
+                last.deltas[i] += unzigzag(encoded);
+                last.values[i].u += last.deltas[i];
+                status.values[column] = last.values[i];
+                break;
+            case ColumnChar:
+            case ColumnInteger:
+                if (!getVarint(buf, encoded)) return false;
+                last.values[i].u += unzigzag(encoded);
+                status.values[column] = last.values[i];
+                break;
+            default:
+                break;
+        }
+    }
+
+    BitReader bits(buf);
+    for (unsigned int i = 0; i < columns.size(); ++i) {
+        if ((last.valid & ((uint64_t)1 << i)) == 0 || statusColumnType[columns[i]] != ColumnReal) continue;
+
+        uint64_t control = 0;
+        if (!bits.read(control, 1)) return false;
+        if (control != 0) {
+            if (!bits.read(control, 1)) return false;
+            if (control != 0) {
+                uint64_t leading = 0;
+                uint64_t length = 0;
+                if (!bits.read(leading, 5) || !bits.read(length, 6) || leading + length + 1 > 64) return false;
+                last.leading[i]  = leading;
+                last.trailing[i] = 64 - leading - length - 1;
+            } else if (last.leading[i] == noWindow) {
+                return false;
+            }
+
+            uint64_t xorBits = 0;
+            if (!bits.read(xorBits, 64 - last.leading[i] - last.trailing[i])) return false;
+            last.values[i].u ^= xorBits << last.trailing[i];
+        }
+        status.values[columns[i]] = last.values[i];
+    }
+
+    countRow(last.timeNs);
+    return true;
+}
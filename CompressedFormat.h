@@ -0,0 +1,108 @@
+#ifndef COMPRESSED_FORMAT_H
+#define COMPRESSED_FORMAT_H COMPRESSED_FORMAT_H
+
+#include "ProcReader.h"
+#include "TimeSpec.h"
+
+#include <istream>
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/// compressed format: a header like the one of @ref BinaryFormat with its own magic bytes and a record size of 0,
+/// followed by variable-length records, each of which only stores the difference to the previous row of the same
+/// series, i.e. the same process, thread or process tree:
+/// - tag byte: @ref recordTag with flags for the series key, a changed set of valid columns and a changed name
+/// - series key: PID and optionally TID as zigzag varints, also the values of the PID and TID columns
+/// - time in nanoseconds: delta-of-delta as zigzag varint
+/// - bitmask of valid columns (bit n = n-th column), XORed with the previous one as varint, only if changed
+/// - name: length as varint followed by the characters, only if changed
+/// - @ref ColumnCounter: delta-of-delta as zigzag varint, @ref ColumnInteger and @ref ColumnChar: delta as zigzag varint
+/// - @ref ColumnReal: XOR with the previous value as in Facebook's Gorilla, bit-packed after all other columns
+///   and padded to full bytes
+/// @note all state is reset by each header, so files can be appended to and split at headers,
+///       series not written for @ref purgeAgeSecs are forgotten by writer and reader alike every @ref purgeRows rows
+namespace CompressedFormat {
+    /// magic bytes at the start of each header
+    const char magic[8] = {'A', 'U', 'D', 'R', 'I', 'A', 'Z', '\0'};
+
+    /// version of the compressed format
+    const uint32_t version = 1;
+
+    /// bits set in the tag byte of each record, which therefore never starts like a header
+    const unsigned char recordTag = 0x80;
+
+    /// flags in the tag byte
+    const unsigned char flagTID     = 0x01; ///< the series key includes a TID
+    const unsigned char flagTree    = 0x02; ///< the series is a process tree, i.e. 'Processes' is valid
+    const unsigned char flagValid   = 0x04; ///< the bitmask of valid columns has changed
+    const unsigned char flagName    = 0x08; ///< the name has changed
+
+    /// series are purged every that many rows
+    const uint64_t purgeRows = 65536;
+
+    /// series not written for that long are purged
+    const double purgeAgeSecs = 60.0;
+}
+
+/// last row of each series, kept alike by @ref CompressedEncoder and @ref CompressedDecoder
+class CompressedSeries {
+  public:
+    /// creates the state for the given columns, in ascending order
+    CompressedSeries(const std::vector<int>& columns);
+
+    /// forgets all series, e.g. at a new header
+    void reset();
+
+  protected:
+    /// last row of a single series
+    struct Series {
+        Series() : timeNs(0), timeDeltaNs(0), valid(0), name(), values(), deltas(), leading(), trailing() {}
+
+        uint64_t                 timeNs;      ///< time of the last row
+        uint64_t                 timeDeltaNs; ///< difference between the times of the last two rows
+        uint64_t                 valid;       ///< columns valid in the last row
+        std::string              name;        ///< last name
+        std::vector<StatusValue> values;      ///< last value of each column
+        std::vector<uint64_t>    deltas;      ///< last difference of each counter column
+        std::vector<uint8_t>     leading;     ///< leading zeros of the last XOR of each real column, 0xff if none yet
+        std::vector<uint8_t>     trailing;    ///< trailing zeros of the last XOR of each real column
+    };
+    typedef std::map<uint64_t, Series> SeriesMap;
+
+    /// returns the key of a series from its tag byte, PID and TID
+    static uint64_t seriesKey(const unsigned char tag, const int64_t pid, const int64_t tid);
+
+    /// returns the series with the given key, a new one if it has not been seen before
+    Series& series(const uint64_t key);
+
+    /// counts a row written or read at @p timeNs and purges old series every @ref CompressedFormat::purgeRows rows
+    void countRow(const uint64_t timeNs);
+
+    std::vector<int> columns;    ///< columns of the rows
+    SeriesMap        state;      ///< last row of each series
+    uint64_t         rows;       ///< rows written or read since the last purge
+    uint64_t         lastTimeNs; ///< time of the last row, new series start from it
+};
+
+/// encodes rows in the compressed format described in @ref CompressedFormat
+class CompressedEncoder : public CompressedSeries {
+  public:
+    CompressedEncoder(const std::vector<int>& columns);
+
+    /// appends the record of a row to @p out
+    void encode(const TimeSpec& ts, const ProcessStatus& status, std::string& out);
+};
+
+/// decodes rows in the compressed format described in @ref CompressedFormat
+class CompressedDecoder : public CompressedSeries {
+  public:
+    CompressedDecoder(const std::vector<int>& columns);
+
+    /// decodes the record of a row from @p in
+    /// @return false if the record is truncated or invalid
+    bool decode(std::istream& in, TimeSpec& ts, ProcessStatus& status);
+};
+
+#endif // COMPRESSED_FORMAT_H
@@ -0,0 +1,197 @@
+#include "CompressedFormat.h"
+#include "Output.h"
+
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+/// a row as written by audria
+struct Row {
+    Row(const TimeSpec& rowTS, const ProcessStatus& rowStatus) : ts(rowTS), status(rowStatus) {}
+
+    TimeSpec      ts;
+    ProcessStatus status;
+};
+
+/// returns the columns written for @p fields, all if empty
+static std::vector<int> columnsOf(const std::set<int>& fields) {
+    std::ostringstream os;
+    return CsvOutput(os, fields).getColumns();
+}
+
+/// returns a status of process @p pid, thread @p tid if not 0, with values derived from @p step
+static ProcessStatus status(const int64_t pid, const int64_t tid, const int64_t step) {
+    ProcessStatus status = ProcessStatus();
+    snprintf(status.name, sizeof(status.name), "proc%d", (int)(pid + step / 10));
+    status.setValid(Name);
+    status.setInteger(PID, pid);
+    if (tid != 0) {
+        status.setInteger(TID, tid);
+    }
+    status.setInteger(State, step % 3 ? 'S' : 'R');
+    status.setInteger(Nice, 5 - step);                        // negative deltas
+    status.setCounter(MinFlt, step * step * 1000);            // growing deltas
+    status.setCounter(MajFlt, 1000 - step);                   // negative deltas of a counter
+    status.setCounter(VmRSSkB, 4096 + (step % 4) * 8);
+    status.setReal(CurCPUPerc, step % 5 ? step * 0.37 : 0.0);
+    status.setReal(AvgCPUPerc, 12.5);                          // unchanged
+    status.setReal(RunTimeSecs, 100.0 + step * 0.1);
+    return status;
+}
+
+/// checks that all @p columns of @p decoded equal those of @p original
+static void checkRow(const std::vector<int>& columns, const ProcessStatus& decoded, const ProcessStatus& original) {
+    for (unsigned int i = 0; i < columns.size(); ++i) {
+        const int column = columns[i];
+        assert(decoded.isValid(column) == original.isValid(column));
+        if (!original.isValid(column)) continue;
+        if (statusColumnType[column] == ColumnText) {
+            assert(strcmp(decoded.name, original.name) == 0);
+        } else {
+            // compares doubles bitwise, which also covers NaN
+            assert(decoded.values[column].u == original.values[column].u);
+        }
+    }
+}
+
+/// encodes @p rows, then decodes them and checks they are unchanged
+/// @param restartAt index of the row a new segment starts at, i.e. both sides are reset, none if out of range
+static void roundTrip(const std::vector<int>& columns, const std::vector<Row>& rows, const size_t restartAt) {
+    CompressedEncoder encoder(columns);
+    std::string encoded;
+    std::vector<size_t> offsets; // start of each row
+    for (size_t i = 0; i < rows.size(); ++i) {
+        if (i == restartAt) encoder.reset();
+        offsets.push_back(encoded.size());
+        encoder.encode(rows[i].ts, rows[i].status, encoded);
+    }
+
+    // each row starts with its tag byte, which never equals the first byte of a header
+    for (size_t i = 0; i < offsets.size(); ++i) {
+        assert((unsigned char)encoded[offsets[i]] & CompressedFormat::recordTag);
+        assert(encoded[offsets[i]] != CompressedFormat::magic[0]);
+    }
+
+    // a reader may start at the start of any segment
+    const size_t first = restartAt < rows.size() ? restartAt : 0;
+    std::istringstream in(encoded.substr(first < rows.size() ? offsets[first] : 0));
+    CompressedDecoder decoder(columns);
+    for (size_t i = first; i < rows.size(); ++i) {
+        TimeSpec ts;
+        ProcessStatus decoded;
+        assert(decoder.decode(in, ts, decoded));
+        assert(ts == rows[i].ts);
+        checkRow(columns, decoded, rows[i].status);
+    }
+    assert(in.peek() == std::istringstream::traits_type::eof());
+
+    // the whole stream decodes if the reader is reset at the same row
+    if (restartAt < rows.size()) {
+        std::istringstream whole(encoded);
+        CompressedDecoder wholeDecoder(columns);
+        for (size_t i = 0; i < rows.size(); ++i) {
+            if (i == restartAt) wholeDecoder.reset();
+            TimeSpec ts;
+            ProcessStatus decoded;
+            assert(wholeDecoder.decode(whole, ts, decoded));
+            assert(ts == rows[i].ts);
+            checkRow(columns, decoded, rows[i].status);
+        }
+    }
+}
+
+void testCompressedFormat() {
+    std::set<int> fields;
+    const std::vector<int> allColumns = columnsOf(fields);
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    const double inf = std::numeric_limits<double>::infinity();
+
+    // processes and threads appearing and disappearing, at irregular intervals
+    std::vector<Row> rows;
+    TimeSpec ts(1000, 999999999);
+    for (int64_t step = 0; step < 60; ++step) {
+        ts += TimeSpec(0, 100000000 + (step % 7) * 1000);
+        for (int64_t pid = 1; pid <= 4; ++pid) {
+            if (pid == 2 && step > 20 && step < 40) continue; // terminated, its PID reused later
+            if (pid == 3 && step % 2) continue;               // staggered
+            rows.push_back(Row(ts, status(pid, 0, step)));
+        }
+        if (step > 10) {
+            rows.push_back(Row(ts, status(4, 4 + step / 20, step))); // a thread of 4
+        }
+    }
+    roundTrip(allColumns, rows, rows.size());
+
+    // counters wrapping around and values changing sign
+    std::vector<Row> extremes;
+    const uint64_t counterMax = std::numeric_limits<uint64_t>::max();
+    const uint64_t counters[] = { counterMax - 5, counterMax, 3, 0, counterMax, 1, 1 };
+    const int64_t integers[] = {
+        std::numeric_limits<int64_t>::max(), std::numeric_limits<int64_t>::min(), -1, 0, 1,
+        std::numeric_limits<int64_t>::min(), std::numeric_limits<int64_t>::max()
+    };
+    const double reals[] = { 0.0, -0.0, nan, inf, -inf, 1e-300, -1e300 };
+    for (unsigned int i = 0; i < sizeof(counters) / sizeof(counters[0]); ++i) {
+        ProcessStatus extreme = status(7, 0, i);
+        extreme.setCounter(MinFlt, counters[i]);
+        extreme.setCounter(TotReadBytes, counterMax - counters[i]);
+        extreme.setInteger(Priority, integers[i]);
+        extreme.setReal(CurCPUPerc, reals[i]);
+        extreme.setReal(UserTimePerc, reals[(i + 3) % 7]);
+        extremes.push_back(Row(TimeSpec(5, i * 3), extreme));
+    }
+    // time going backwards, e.g. after appending to an older file
+    extremes.push_back(Row(TimeSpec(1, 0), status(7, 0, 8)));
+    roundTrip(allColumns, extremes, extremes.size());
+
+    // columns becoming invalid and valid again, empty and long names
+    std::vector<Row> changing;
+    for (int64_t step = 0; step < 20; ++step) {
+        ProcessStatus partial = status(9, 0, step);
+        if (step % 3 == 0) partial.valid &= ~((uint64_t)1 << CurCPUPerc);
+        if (step % 4 == 0) partial.valid &= ~((uint64_t)1 << MinFlt);
+        if (step == 5) partial.name[0] = '\0';
+        if (step == 6) {
+            memset(partial.name, 'x', maxNameLength - 1);
+            partial.name[maxNameLength - 1] = '\0';
+        }
+        changing.push_back(Row(TimeSpec(10 + step, 0), partial));
+    }
+    roundTrip(allColumns, changing, changing.size());
+
+    // a new segment restarts the stream, its rows decode without the previous segment
+    roundTrip(allColumns, rows, rows.size() / 2);
+
+    // a subset of columns, the PID and TID columns are taken from the series key
+    std::set<int> someFields;
+    someFields.insert(TID);
+    someFields.insert(MinFlt);
+    someFields.insert(CurCPUPerc);
+    roundTrip(columnsOf(someFields), rows, rows.size());
+
+    // series not written for a while are purged by writer and reader alike
+    std::vector<Row> purged;
+    purged.push_back(Row(TimeSpec(0, 0), status(11, 0, 1)));
+    for (uint64_t i = 0; i < CompressedFormat::purgeRows; ++i) {
+        purged.push_back(Row(TimeSpec(CompressedFormat::purgeAgeSecs + 1 + i / 1000, 0), status(12, 0, i % 50)));
+    }
+    purged.push_back(Row(TimeSpec(200, 0), status(11, 0, 2)));
+    roundTrip(allColumns, purged, purged.size());
+
+    // truncated records are rejected
+    CompressedEncoder encoder(allColumns);
+    std::string encoded;
+    encoder.encode(rows[0].ts, rows[0].status, encoded);
+    for (size_t len = 0; len < encoded.size(); ++len) {
+        std::istringstream in(encoded.substr(0, len));
+        CompressedDecoder decoder(allColumns);
+        TimeSpec decodedTS;
+        ProcessStatus decoded;
+        assert(!decoder.decode(in, decodedTS, decoded));
+    }
+}
@@ -0,0 +1,298 @@
+#include "ControlSocket.h"
+
+#include <iostream>
+#include <vector>
+#include <cassert>
+#include <cstring>
+#include <ctime>
+
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// maximum number of connected clients, further connections are closed right away
+static const size_t maxClients = 64;
+
+// maximum length of a request line
+static const size_t maxRequestLength = 4096;
+
+// maximum amount of data not sent yet to a single client, a client which doesn't read is disconnected then
+static const size_t maxPendingOutput = 16 * 1024 * 1024;
+
+ControlSocket::ControlSocket() : sock(-1), socketPath(), clients(), requests(), subscribers(0) {
+}
+
+ControlSocket::~ControlSocket() {
+    while (!clients.empty()) {
+        disconnect(clients.begin());
+    }
+    if (sock != -1) {
+        close(sock);
+        unlink(socketPath.c_str());
+    }
+}
+
+bool ControlSocket::open(const std::string& path) {
+    assert(sock == -1);
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "invalid path for control socket '" << path << "'" << std::endl;
+        return false;
+    }
+    memcpy(addr.sun_path, path.c_str(), path.size());
+
+    sock = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (sock == -1) {
+        std::cerr << "could not open control socket: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    // a socket left behind by a terminated audria can be replaced, one still in use cannot
+    struct stat st;
+    if (lstat(path.c_str(), &st) == 0) {
+        if (!S_ISSOCK(st.st_mode) || connect(sock, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == 0 ||
+            errno == EAGAIN) {
+            std::cerr << "could not bind control socket to '" << path << "': already exists" << std::endl;
+            close(sock);
+            sock = -1;
+            return false;
+        }
+        unlink(path.c_str());
+    }
+
+    // clients can change what we monitor, often as root, so only our user may connect, which requires write access
+    const mode_t oldMask = umask(077);
+    const int bound = bind(sock, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+    umask(oldMask);
+    if (bound == -1 || listen(sock, 16) == -1) {
+        std::cerr << "could not bind control socket to '" << path << "': " << strerror(errno) << std::endl;
+        close(sock);
+        sock = -1;
+        return false;
+    }
+    socketPath = path;
+
+    return true;
+}
+
+bool ControlSocket::wait(const TimeSpec& timeoutTS) {
+    if (sock == -1) return false;
+
+    TimeSpec deadlineTS;
+    clock_gettime(CLOCK_MONOTONIC, &deadlineTS.ts);
+    deadlineTS += timeoutTS;
+
+    std::vector<struct pollfd> fds;
+    while (requests.empty()) {
+        fds.clear();
+        struct pollfd listening = { sock, POLLIN, 0 };
+        fds.push_back(listening);
+        for (ClientMap::const_iterator clientIt = clients.begin(); clientIt != clients.end(); ++clientIt) {
+            const Client& client = clientIt->second;
+            struct pollfd connected = { clientIt->first, (short)((client.closed ? 0 : POLLIN) | (client.output.empty() ? 0 : POLLOUT)), 0 };
+            fds.push_back(connected);
+        }
+
+        TimeSpec nowTS;
+        clock_gettime(CLOCK_MONOTONIC, &nowTS.ts);
+        const TimeSpec remainingTS = deadlineTS > nowTS ? deadlineTS - nowTS : TimeSpec();
+        const int ready = ppoll(&fds[0], fds.size(), &remainingTS.ts, NULL);
+        if (ready == -1) {
+            // interrupted by a signal, e.g. a termination request
+            if (errno != EINTR) {
+                std::cerr << "could not poll control socket: " << strerror(errno) << std::endl;
+            }
+            break;
+        }
+        if (ready == 0) break;
+
+        for (size_t i = 1; i < fds.size(); ++i) {
+            ClientMap::iterator clientIt = clients.find(fds[i].fd);
+            if (fds[i].revents == 0 || clientIt == clients.end()) continue;
+
+            // a client which has only shut down its side still reads the replies, a hung up one cannot
+            if ((fds[i].revents & (POLLHUP | POLLERR)) ||
+                ((fds[i].revents & POLLIN) && !receive(clientIt->first, clientIt->second))) {
+                disconnect(clientIt);
+                continue;
+            }
+            flush(clientIt);
+        }
+        if (fds[0].revents & POLLIN) {
+            accept();
+        }
+        if (remainingTS == TimeSpec()) break;
+    }
+
+    return !requests.empty();
+}
+
+bool ControlSocket::nextRequest(Request& request) {
+    if (requests.empty()) return false;
+
+    request = requests.front();
+    requests.pop_front();
+    return true;
+}
+
+void ControlSocket::reply(const int client, const std::string& text) {
+    ClientMap::iterator clientIt = clients.find(client);
+    if (clientIt == clients.end()) return;
+
+    --clientIt->second.pending;
+    clientIt->second.output += text;
+    flush(clientIt);
+}
+
+void ControlSocket::subscribe(const int client) {
+    ClientMap::iterator clientIt = clients.find(client);
+    if (clientIt == clients.end() || clientIt->second.subscribed) return;
+
+    clientIt->second.subscribed = true;
+    ++subscribers;
+}
+
+void ControlSocket::publish(const std::string& text) {
+    for (ClientMap::iterator clientIt = clients.begin(); clientIt != clients.end(); ) {
+        ClientMap::iterator subscriberIt = clientIt++;
+        if (!subscriberIt->second.subscribed) continue;
+
+        subscriberIt->second.output += text;
+        flush(subscriberIt);
+    }
+}
+
+void ControlSocket::accept() {
+    for (;;) {
+        const int fd = accept4(sock, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd == -1) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != ECONNABORTED && errno != EINTR) {
+                std::cerr << "could not accept control connection: " << strerror(errno) << std::endl;
+            }
+            if (errno != ECONNABORTED && errno != EINTR) {
+                return;
+            }
+            continue;
+        }
+        if (clients.size() >= maxClients) {
+            close(fd);
+            continue;
+        }
+        clients.insert(std::make_pair(fd, Client()));
+    }
+}
+
+bool ControlSocket::receive(const int fd, Client& client) {
+    char buf[4096];
+    for (;;) {
+        const ssize_t len = recv(fd, buf, sizeof(buf), 0);
+        if (len == 0) {
+            client.closed = true;
+            break;
+        }
+        if (len == -1) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return false;
+        }
+        client.input.append(buf, len);
+    }
+
+    size_t start = 0, end;
+    while ((end = client.input.find('\n', start)) != std::string::npos) {
+        Request request;
+        request.client = fd;
+        request.line   = client.input.substr(start, end - start);
+        if (!request.line.empty() && request.line[request.line.size() - 1] == '\r') {
+            request.line.erase(request.line.size() - 1);
+        }
+        if (!request.line.empty()) {
+            requests.push_back(request);
+            ++client.pending;
+        }
+        start = end + 1;
+    }
+    client.input.erase(0, start);
+
+    return client.input.size() <= maxRequestLength;
+}
+
+bool ControlSocket::send(const int fd, Client& client) {
+    size_t sent = 0;
+    while (sent < client.output.size()) {
+        const ssize_t len = ::send(fd, client.output.data() + sent, client.output.size() - sent, MSG_NOSIGNAL);
+        if (len == -1) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return false;
+        }
+        sent += len;
+    }
+    client.output.erase(0, sent);
+
+    return client.output.size() <= maxPendingOutput;
+}
+
+void ControlSocket::flush(ClientMap::iterator clientIt) {
+    Client& client = clientIt->second;
+    if (!send(clientIt->first, client) ||
+        (client.closed && client.pending == 0 && client.output.empty() && !client.subscribed)) {
+        disconnect(clientIt);
+    }
+}
+
+void ControlSocket::disconnect(ClientMap::iterator clientIt) {
+    const int fd = clientIt->first;
+    for (std::deque<Request>::iterator requestIt = requests.begin(); requestIt != requests.end(); ) {
+        if (requestIt->client == fd) {
+            requestIt = requests.erase(requestIt);
+        } else {
+            ++requestIt;
+        }
+    }
+    if (clientIt->second.subscribed) {
+        --subscribers;
+    }
+    close(fd);
+    clients.erase(clientIt);
+}
+
+ControlOutput::ControlOutput(Output* nextOutput, std::ostream& outStream, const std::set<int>& fields,
+                             ControlSocket& controlSocket) :
+  Output(outStream, fields), next(nextOutput), control(controlSocket), rows(), csv(rows, fields) {
+}
+
+ControlOutput::~ControlOutput() {
+    delete next;
+}
+
+void ControlOutput::writeHeader() {
+    next->writeHeader();
+}
+
+void ControlOutput::writeRow(const TimeSpec& ts, const ProcessStatus& status) {
+    next->writeRow(ts, status);
+    if (control.hasSubscribers()) {
+        csv.writeRow(ts, status);
+    }
+}
+
+std::string ControlOutput::header() const {
+    std::ostringstream text;
+    CsvOutput(text, std::set<int>(columns.begin(), columns.end())).writeHeader();
+    return text.str();
+}
+
+void ControlOutput::publishRows() {
+    if (rows.tellp() <= 0) return;
+
+    rows << '\n';
+    control.publish(rows.str());
+    rows.str(std::string());
+}
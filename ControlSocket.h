@@ -0,0 +1,128 @@
+#ifndef CONTROL_SOCKET_H
+#define CONTROL_SOCKET_H CONTROL_SOCKET_H
+
+#include "Output.h"
+#include "TimeSpec.h"
+
+#include <deque>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+
+/// Unix domain socket clients send requests to, one per line, each answered by a reply ending with an empty line,
+/// clients can also subscribe to the rows written in each iteration
+/// @note never blocks: replies are sent as far as the client reads them, clients which fall too far behind
+///       or send overlong lines are disconnected
+class ControlSocket {
+  public:
+    /// a single request line received from a client
+    struct Request {
+        Request() : client(-1), line() {}
+
+        int         client; ///< client which sent the request, pass to @ref reply()
+        std::string line;   ///< request without the line break
+    };
+
+    ControlSocket();
+    ~ControlSocket();
+
+    /// listens on the Unix domain socket @p path, replaces a stale socket of the same path,
+    /// the socket is created with mode 0600, i.e. only our user can connect
+    /// @return false on errors, an error message has been printed then
+    bool open(const std::string& path);
+
+    /// returns whether we are listening
+    bool isOpen() const { return sock != -1; }
+
+    /// accepts new clients, receives requests and sends pending replies until a request is available
+    /// or @p timeoutTS has passed, doesn't block if @p timeoutTS is zero
+    /// @return whether requests are available via @ref nextRequest()
+    bool wait(const TimeSpec& timeoutTS);
+
+    /// takes the oldest request received
+    /// @return false if no request is available
+    bool nextRequest(Request& request);
+
+    /// sends @p text to @p client, ignored if the client has disconnected in the meantime
+    void reply(const int client, const std::string& text);
+
+    /// sends everything passed to @ref publish() to @p client from now on
+    void subscribe(const int client);
+
+    /// returns whether any client has subscribed
+    bool hasSubscribers() const { return subscribers != 0; }
+
+    /// sends @p text to all subscribed clients
+    void publish(const std::string& text);
+
+  private:
+    // not copyable, owns the sockets
+    ControlSocket(const ControlSocket& other);
+    ControlSocket& operator=(const ControlSocket& other);
+
+    /// a connected client
+    struct Client {
+        Client() : input(), output(), pending(0), subscribed(false), closed(false) {}
+
+        std::string  input;      ///< received data without a complete line yet
+        std::string  output;     ///< data not sent yet
+        unsigned int pending;    ///< number of requests not answered yet
+        bool         subscribed; ///< whether the client has subscribed
+        bool         closed;     ///< whether the client has shut down its side, it is disconnected once all replies are sent
+    };
+    typedef std::map<int, Client> ClientMap;
+
+    /// accepts all pending connections
+    void accept();
+
+    /// receives all pending data from @p client and queues complete lines as requests
+    /// @return false if the client has to be disconnected
+    bool receive(const int fd, Client& client);
+
+    /// sends as much pending data to @p client as possible without blocking
+    /// @return false if the client has to be disconnected
+    bool send(const int fd, Client& client);
+
+    /// sends pending data to @p clientIt, disconnects it if that fails or if it is done
+    void flush(ClientMap::iterator clientIt);
+
+    /// disconnects @p clientIt and drops its requests not taken yet
+    void disconnect(ClientMap::iterator clientIt);
+
+    int                 sock;        ///< listening socket, -1 if not open
+    std::string         socketPath;  ///< path the socket is bound to
+    ClientMap           clients;     ///< connected clients by their socket
+    std::deque<Request> requests;    ///< requests received but not taken yet
+    unsigned int        subscribers; ///< number of subscribed clients
+};
+
+/// writes rows to another output and also collects them as CSV for the clients subscribed to a @ref ControlSocket,
+/// the collected rows are published by @ref publishRows()
+class ControlOutput : public Output {
+  public:
+    /// creates an output for the given columns forwarding all rows to @p nextOutput, which it takes ownership of
+    ControlOutput(Output* nextOutput, std::ostream& outStream, const std::set<int>& fields, ControlSocket& controlSocket);
+    ~ControlOutput();
+
+    void writeHeader();
+    void writeRow(const TimeSpec& ts, const ProcessStatus& status);
+
+    /// returns the CSV header for subscribers
+    std::string header() const;
+
+    /// publishes the rows collected since the last call as a single reply, if any
+    void publishRows();
+
+  private:
+    // not copyable, owns the next output
+    ControlOutput(const ControlOutput& other);
+    ControlOutput& operator=(const ControlOutput& other);
+
+    Output*            next;    ///< output all rows are forwarded to
+    ControlSocket&     control; ///< socket to publish the rows to
+    std::ostringstream rows;    ///< rows collected for subscribers
+    CsvOutput          csv;     ///< formats the rows for subscribers
+};
+
+#endif // CONTROL_SOCKET_H
@@ -0,0 +1,54 @@
+#include "Format.h"
+
+#include <cstdio>
+
+#if __cplusplus >= 201703L
+#include <charconv>
+#endif
+
+size_t Format::integer(char* buf, long long value) {
+    if (value < 0) {
+        *buf = '-';
+        // negate as unsigned to handle the smallest value
+        return counter(buf + 1, 0ULL - static_cast<unsigned long long>(value)) + 1;
+    }
+    return counter(buf, value);
+}
+
+size_t Format::counter(char* buf, unsigned long long value) {
+    // write digits backwards into a temporary buffer, then copy them
+    char digits[20];
+    char* pos = digits + sizeof(digits);
+    do {
+        *--pos = '0' + value % 10;
+        value /= 10;
+    } while (value != 0);
+
+    const size_t len = digits + sizeof(digits) - pos;
+    for (size_t i = 0; i < len; ++i) {
+        buf[i] = pos[i];
+    }
+    return len;
+}
+
+size_t Format::real(char* buf, double value) {
+#if defined(__cpp_lib_to_chars)
+    // exact like printf(), including rounding and the spelling of infinity and NaN
+    return std::to_chars(buf, buf + maxLength, value, std::chars_format::fixed, 2).ptr - buf;
+#else
+    return snprintf(buf, maxLength, "%.2f", value);
+#endif
+}
+
+size_t Format::timeSpec(char* buf, const timespec& ts) {
+    size_t len = integer(buf, ts.tv_sec);
+    buf[len++] = '.';
+
+    // nanoseconds are zero-padded to nine digits
+    long nsec = ts.tv_nsec;
+    for (int i = 8; i >= 0; --i) {
+        buf[len + i] = '0' + nsec % 10;
+        nsec /= 10;
+    }
+    return len + 9;
+}
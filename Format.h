@@ -0,0 +1,27 @@
+#ifndef FORMAT_H
+#define FORMAT_H FORMAT_H
+
+#include <cstddef>
+#include <ctime>
+
+/// fast number formatting into character buffers, without going through iostreams
+/// @note output is identical to writing the values to a std::ostream with std::fixed and std::setprecision(2)
+/// @note none of the functions terminates the written string
+namespace Format {
+    /// maximum number of characters written by a single call, enough for "%.2f" of the largest double
+    const size_t maxLength = 320;
+
+    /// writes a signed integer, returns the number of characters written
+    size_t integer(char* buf, long long value);
+
+    /// writes an unsigned integer, returns the number of characters written
+    size_t counter(char* buf, unsigned long long value);
+
+    /// writes a real number with two decimal places, returns the number of characters written
+    size_t real(char* buf, double value);
+
+    /// writes a timestamp as seconds with nine decimal places, returns the number of characters written
+    size_t timeSpec(char* buf, const timespec& ts);
+}
+
+#endif // FORMAT_H
@@ -0,0 +1,242 @@
+#include "Output.h"
+#include "definitions.h"
+#include "Format.h"
+
+#include <cassert>
+#include <cstring>
+
+Output::Output(std::ostream& outStream, const std::set<int>& fields) : os(outStream), columns() {
+    for (int statusColumn = 0; statusColumn < StatusColumnCount; ++statusColumn) {
+        // skip unwanted fields
+        if (!fields.empty() && fields.count(statusColumn) == 0) continue;
+        columns.push_back(statusColumn);
+    }
+}
+
+ChangeFilter::ChangeFilter(const std::set<int>& fields, const ChangePolicy& changePolicy) :
+  columns(), heartbeatTS(changePolicy.heartbeatSecs), policy(changePolicy) {
+    for (int statusColumn = 0; statusColumn < StatusColumnCount; ++statusColumn) {
+        if (!fields.empty() && fields.count(statusColumn) == 0) continue;
+
+        switch (statusColumn) {
+            case AvgCPUPerc:
+            case CurCPUPerc:
+            case RunTimeSecs:
+            case CurReadBytes:
+            case CurReadBytesStorage:
+            case CurWrittenBytes:
+            case CurWrittenBytesStorage:
+            case CurReadCalls:
+            case CurWriteCalls:
+            case CurRunQueueWaitPerc:
+            case IntervalSecs:
+                break; // change in every iteration or only count via the thresholds
+            default:
+                columns.push_back(statusColumn);
+                break;
+        }
+    }
+}
+
+bool ChangeFilter::pass(const TimeSpec& ts, const ProcessStatus& status, ProcessStatus& last, TimeSpec& lastTS) const {
+    bool changed = lastTS == TimeSpec() || isBusy(status) || isBusy(last) ||
+                   (policy.heartbeatSecs > 0.0 && !(ts < lastTS + heartbeatTS));
+    for (unsigned int i = 0; i < columns.size() && !changed; ++i) {
+        const int column = columns[i];
+        if (status.isValid(column) != last.isValid(column)) {
+            changed = true;
+        } else if (!status.isValid(column)) {
+            continue;
+        } else if (statusColumnType[column] == ColumnText) {
+            changed = strcmp(status.name, last.name) != 0;
+        } else {
+            changed = status.values[column].u != last.values[column].u;
+        }
+    }
+    if (!changed) return false;
+
+    last   = status;
+    lastTS = ts;
+    return true;
+}
+
+bool ChangeFilter::isBusy(const ProcessStatus& status) const {
+    static const int ioColumns[] = { CurReadBytes, CurReadBytesStorage, CurWrittenBytes, CurWrittenBytesStorage };
+
+    if (status.isValid(CurCPUPerc) && status.values[CurCPUPerc].d >= policy.cpuPerc) {
+        return true;
+    }
+    for (unsigned int i = 0; i < sizeof(ioColumns) / sizeof(ioColumns[0]); ++i) {
+        if (status.isValid(ioColumns[i]) && status.values[ioColumns[i]].d >= policy.ioBytesPerSec) {
+            return true;
+        }
+    }
+    return false;
+}
+
+CsvOutput::CsvOutput(std::ostream& outStream, const std::set<int>& fields) : Output(outStream, fields), line() {
+    line.reserve(columns.size() * 16 + 64);
+}
+
+void CsvOutput::writeHeader() {
+    os << "Time";
+    for (unsigned int i = 0; i < columns.size(); ++i) {
+        os << "," << statusColumnHeader[columns[i]];
+    }
+    os << '\n';
+}
+
+void CsvOutput::writeRow(const TimeSpec& ts, const ProcessStatus& status) {
+    // assemble the whole line first, the stream is only touched once
+    char buf[Format::maxLength];
+    line.assign(buf, Format::timeSpec(buf, ts.ts));
+    for (unsigned int i = 0; i < columns.size(); ++i) {
+        line += ',';
+        writeColumn(status, columns[i]);
+    }
+    line += '\n';
+    os.write(line.data(), line.size());
+}
+
+void CsvOutput::writeColumn(const ProcessStatus& status, const int column) {
+    if (unlikely(!status.isValid(column))) {
+        line.append("0.0", 3);
+        return;
+    }
+
+    char buf[Format::maxLength];
+    switch (statusColumnType[column]) {
+        case ColumnText:
+            // if printing a program name containing a comma, enclose it in double-quotes (rfc4180 section 2.6)
+            if (unlikely(strchr(status.name, ',') != NULL)) {
+                line += '"';
+                line += status.name;
+                line += '"';
+            } else {
+                line += status.name;
+            }
+            break;
+        case ColumnChar:
+            line += (char)status.values[column].i;
+            break;
+        case ColumnInteger:
+            line.append(buf, Format::integer(buf, status.values[column].i));
+            break;
+        case ColumnCounter:
+            line.append(buf, Format::counter(buf, status.values[column].u));
+            break;
+        case ColumnReal:
+            line.append(buf, Format::real(buf, status.values[column].d));
+            break;
+    }
+}
+
+uint32_t BinaryFormat::recordSize(const std::vector<int>& columns) {
+    uint32_t size = sizeof(RecordHeader);
+    for (unsigned int i = 0; i < columns.size(); ++i) {
+        size += statusColumnType[columns[i]] == ColumnText ? maxNameLength : sizeof(StatusValue);
+    }
+    return size;
+}
+
+void BinaryFormat::encodeRecord(char* record, const std::vector<int>& columns, const TimeSpec& ts,
+                                const ProcessStatus& status) {
+    char* pos = record;
+
+    RecordHeader header;
+    header.timeNs = (uint64_t)ts.ts.tv_sec * TimeSpec::secInNsec + ts.ts.tv_nsec;
+    header.pid    = status.isValid(PID) ? status.values[PID].i : 0;
+    header.valid  = 0;
+    for (unsigned int i = 0; i < columns.size(); ++i) {
+        if (status.isValid(columns[i])) {
+            header.valid |= (uint64_t)1 << i;
+        }
+    }
+    memcpy(pos, &header, sizeof(header));
+    pos += sizeof(header);
+
+    for (unsigned int i = 0; i < columns.size(); ++i) {
+        if (statusColumnType[columns[i]] == ColumnText) {
+            memcpy(pos, status.name, maxNameLength);
+            pos += maxNameLength;
+        } else {
+            memcpy(pos, &status.values[columns[i]], sizeof(StatusValue));
+            pos += sizeof(StatusValue);
+        }
+    }
+    assert(pos == record + recordSize(columns));
+}
+
+void BinaryFormat::decodeRecord(const char* record, const std::vector<int>& columns, TimeSpec& ts,
+                                ProcessStatus& status) {
+    const char* pos = record;
+
+    RecordHeader header;
+    memcpy(&header, pos, sizeof(header));
+    pos += sizeof(header);
+
+    ts = TimeSpec(header.timeNs / TimeSpec::secInNsec, header.timeNs % TimeSpec::secInNsec);
+    status = ProcessStatus();
+    for (unsigned int i = 0; i < columns.size(); ++i) {
+        if (header.valid & ((uint64_t)1 << i)) {
+            status.setValid(columns[i]);
+        }
+        if (statusColumnType[columns[i]] == ColumnText) {
+            memcpy(status.name, pos, maxNameLength);
+            status.name[maxNameLength - 1] = '\0';
+            pos += maxNameLength;
+        } else {
+            memcpy(&status.values[columns[i]], pos, sizeof(StatusValue));
+            pos += sizeof(StatusValue);
+        }
+    }
+}
+
+BinaryOutput::BinaryOutput(std::ostream& outStream, const std::set<int>& fields) :
+  Output(outStream, fields), record(BinaryFormat::recordSize(columns)) {
+}
+
+/// writes a header of the binary or compressed format
+static void writeFormatHeader(std::ostream& os, const char* magic, const uint32_t version,
+                              const std::vector<int>& columns, const uint32_t recordSize) {
+    BinaryFormat::Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, magic, sizeof(header.magic));
+    header.version     = version;
+    header.columnCount = columns.size();
+    header.recordSize  = recordSize;
+    os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    for (unsigned int i = 0; i < columns.size(); ++i) {
+        const uint16_t id   = columns[i];
+        const uint16_t type = statusColumnType[columns[i]];
+        os.write(reinterpret_cast<const char*>(&id),   sizeof(id));
+        os.write(reinterpret_cast<const char*>(&type), sizeof(type));
+    }
+    os.flush();
+}
+
+void BinaryOutput::writeHeader() {
+    writeFormatHeader(os, BinaryFormat::magic, BinaryFormat::version, columns, record.size());
+}
+
+void BinaryOutput::writeRow(const TimeSpec& ts, const ProcessStatus& status) {
+    BinaryFormat::encodeRecord(&record[0], columns, ts, status);
+    os.write(&record[0], record.size());
+}
+
+CompressedOutput::CompressedOutput(std::ostream& outStream, const std::set<int>& fields) :
+  Output(outStream, fields), encoder(columns), record() {
+}
+
+void CompressedOutput::writeHeader() {
+    // readers may start at any header, e.g. of a later segment
+    encoder.reset();
+    writeFormatHeader(os, CompressedFormat::magic, CompressedFormat::version, columns, 0);
+}
+
+void CompressedOutput::writeRow(const TimeSpec& ts, const ProcessStatus& status) {
+    record.clear();
+    encoder.encode(ts, status, record);
+    os.write(record.data(), record.size());
+}
@@ -0,0 +1,153 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H OUTPUT_H
+
+#include "CompressedFormat.h"
+#include "ProcReader.h"
+#include "TimeSpec.h"
+
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/// formats rows can be written in
+typedef enum {
+    FormatCsv,       ///< comma-separated values, see @ref CsvOutput
+    FormatBinary,    ///< fixed-width records, see @ref BinaryOutput
+    FormatCompressed ///< records compressed per process, see @ref CompressedOutput
+} OutputFormat;
+
+/// writes rows of process status to an output stream
+class Output {
+  public:
+    /// creates an output for the given columns, all columns if empty
+    Output(std::ostream& outStream, const std::set<int>& fields);
+    virtual ~Output() {}
+
+    /// writes the header describing the columns
+    virtual void writeHeader() = 0;
+
+    /// writes a single row
+    virtual void writeRow(const TimeSpec& ts, const ProcessStatus& status) = 0;
+
+    /// returns the columns written, in ascending order
+    const std::vector<int>& getColumns() const { return columns; }
+
+  protected:
+    std::ostream&    os;      ///< stream to write to
+    std::vector<int> columns; ///< columns to write, in ascending order
+};
+
+/// when rows of a process are written if only changes are written
+struct ChangePolicy {
+    ChangePolicy() : heartbeatSecs(60.0), cpuPerc(1.0), ioBytesPerSec(1.0) {}
+
+    double heartbeatSecs; ///< write a row at least this often, 0 for never
+    double cpuPerc;       ///< write rows while 'CurCPUPerc' is at least this high
+    double ioBytesPerSec; ///< write rows while any current IO rate in bytes is at least this high
+};
+
+/// decides whether a row is written at all, suppresses rows of idle processes repeating their last row:
+/// a row is written if any of the columns differs from the last row written for the same process,
+/// while the process is busy according to the @ref ChangePolicy and once more when it has become idle,
+/// or if the last row is older than the heartbeat
+/// @note columns changing by themselves, i.e. runtime, averages and rates, only count via the thresholds
+class ChangeFilter {
+  public:
+    /// creates a filter comparing the given columns, all if empty
+    ChangeFilter(const std::set<int>& fields, const ChangePolicy& changePolicy);
+
+    /// returns whether @p status read at @p ts shall be written,
+    /// stores it in @p last and @p lastTS then, which have to be kept per process
+    bool pass(const TimeSpec& ts, const ProcessStatus& status, ProcessStatus& last, TimeSpec& lastTS) const;
+
+  private:
+    /// returns whether the process is busy according to the thresholds
+    bool isBusy(const ProcessStatus& status) const;
+
+    std::vector<int> columns; ///< columns compared with the last row
+    TimeSpec         heartbeatTS; ///< heartbeat interval
+    ChangePolicy     policy;  ///< thresholds and heartbeat
+};
+
+/// writes rows as comma-separated values, one line per row
+class CsvOutput : public Output {
+  public:
+    CsvOutput(std::ostream& outStream, const std::set<int>& fields);
+
+    void writeHeader();
+    void writeRow(const TimeSpec& ts, const ProcessStatus& status);
+
+  private:
+    /// appends a single status column to the current line, columns without a value are written as "0.0"
+    void writeColumn(const ProcessStatus& status, const int column);
+
+    std::string line; ///< line being assembled
+};
+
+/// binary format: a header followed by fixed-width records, all values in host byte order
+/// - header: @ref binaryMagic, version, number of columns, record size in bytes,
+///           followed by the ID (see @ref StatusColumns) and type (see @ref ColumnType) of each column
+/// - record: time in nanoseconds, PID, bitmask of columns holding a value (bit n = n-th column),
+///           followed by the value of each column: @ref maxNameLength bytes for @ref Name, 8 bytes otherwise
+/// @note appending to an existing file starts a new header, readers have to expect further headers between records
+namespace BinaryFormat {
+    /// magic bytes at the start of each header
+    const char magic[8] = {'A', 'U', 'D', 'R', 'I', 'A', 'B', '\0'};
+
+    /// version of the binary format
+    const uint32_t version = 1;
+
+    /// fixed part of the header
+    struct Header {
+        char     magic[8];
+        uint32_t version;
+        uint32_t columnCount;
+        uint32_t recordSize;
+        uint32_t reserved;
+    };
+
+    /// fixed part of each record
+    struct RecordHeader {
+        uint64_t timeNs;
+        int64_t  pid;
+        uint64_t valid;
+    };
+
+    /// returns the size of a record for the given columns
+    uint32_t recordSize(const std::vector<int>& columns);
+
+    /// encodes a row into @p record, which has to hold @ref recordSize() bytes
+    void encodeRecord(char* record, const std::vector<int>& columns, const TimeSpec& ts, const ProcessStatus& status);
+
+    /// decodes a record into its timestamp and process status
+    void decodeRecord(const char* record, const std::vector<int>& columns, TimeSpec& ts, ProcessStatus& status);
+}
+
+/// writes rows in the binary format described in @ref BinaryFormat
+class BinaryOutput : public Output {
+  public:
+    BinaryOutput(std::ostream& outStream, const std::set<int>& fields);
+
+    void writeHeader();
+    void writeRow(const TimeSpec& ts, const ProcessStatus& status);
+
+  private:
+    std::vector<char> record; ///< buffer for a single record
+};
+
+/// writes rows in the compressed format described in @ref CompressedFormat
+class CompressedOutput : public Output {
+  public:
+    CompressedOutput(std::ostream& outStream, const std::set<int>& fields);
+
+    void writeHeader();
+    void writeRow(const TimeSpec& ts, const ProcessStatus& status);
+
+  private:
+    CompressedEncoder encoder; ///< state of all series since the last header
+    std::string       record;  ///< buffer for a single record
+};
+
+#endif // OUTPUT_H
@@ -0,0 +1,121 @@
+#include "Output.h"
+
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cassert>
+#include <cstring>
+#include <limits>
+
+/// returns a status with a distinct value in every column, @p seed varies the values
+static ProcessStatus fullStatus(const int seed) {
+    ProcessStatus status = ProcessStatus();
+    strcpy(status.name, "proc, with comma");
+    status.setValid(Name);
+    for (int column = 0; column < StatusColumnCount; ++column) {
+        switch (statusColumnType[column]) {
+            case ColumnChar:
+                status.setInteger(column, 'R' + seed % 2);
+                break;
+            case ColumnInteger:
+                status.setInteger(column, (column % 2 ? -1 : 1) * (column * 1000 + seed));
+                break;
+            case ColumnCounter:
+                status.setCounter(column, std::numeric_limits<uint64_t>::max() - column - seed);
+                break;
+            case ColumnReal:
+                status.setReal(column, column * 1.25 + seed);
+                break;
+            default:
+                break;
+        }
+    }
+    return status;
+}
+
+/// encodes @p status for @p columns, decodes it again and checks that all valid columns survived
+static ProcessStatus roundTrip(const std::vector<int>& columns, const TimeSpec& ts, const ProcessStatus& status) {
+    std::vector<char> record(BinaryFormat::recordSize(columns));
+    BinaryFormat::encodeRecord(&record[0], columns, ts, status);
+
+    TimeSpec decodedTS;
+    ProcessStatus decoded;
+    BinaryFormat::decodeRecord(&record[0], columns, decodedTS, decoded);
+    assert(decodedTS == ts);
+
+    uint64_t valid = 0;
+    for (unsigned int i = 0; i < columns.size(); ++i) {
+        const int column = columns[i];
+        if (!status.isValid(column)) continue;
+        valid |= (uint64_t)1 << column;
+        if (statusColumnType[column] != ColumnText) {
+            assert(decoded.values[column].u == status.values[column].u);
+        }
+    }
+    assert(decoded.valid == valid);
+    return decoded;
+}
+
+/// returns the CSV header and row written for @p status
+static std::string csv(const std::set<int>& fields, const TimeSpec& ts, const ProcessStatus& status) {
+    std::ostringstream os;
+    CsvOutput output(os, fields);
+    output.writeHeader();
+    output.writeRow(ts, status);
+    return os.str();
+}
+
+void testOutput() {
+    const TimeSpec ts(1234, 567890123);
+
+    // all columns of every type
+    std::set<int> allFields;
+    const std::vector<int> allColumns = CsvOutput(std::cout, allFields).getColumns();
+    assert((int)allColumns.size() == StatusColumnCount);
+    const ProcessStatus full = fullStatus(7);
+    const ProcessStatus decodedFull = roundTrip(allColumns, ts, full);
+    assert(strcmp(decodedFull.name, full.name) == 0);
+    assert(csv(allFields, ts, decodedFull) == csv(allFields, ts, full));
+
+    // the longest name fitting into the buffer
+    ProcessStatus longName = full;
+    memset(longName.name, 'n', maxNameLength - 1);
+    longName.name[maxNameLength - 1] = '\0';
+    const ProcessStatus decodedLongName = roundTrip(allColumns, ts, longName);
+    assert(memcmp(decodedLongName.name, longName.name, maxNameLength) == 0);
+    assert(csv(allFields, ts, decodedLongName) == csv(allFields, ts, longName));
+
+    // a name filling the whole buffer is terminated on decoding
+    ProcessStatus unterminated = full;
+    memset(unterminated.name, 'u', maxNameLength);
+    const ProcessStatus decodedUnterminated = roundTrip(allColumns, ts, unterminated);
+    assert(strlen(decodedUnterminated.name) == maxNameLength - 1);
+
+    // partially valid rows keep which columns hold a value, invalid ones are written as "0.0"
+    std::set<int> someFields;
+    someFields.insert(Name);
+    someFields.insert(State);
+    someFields.insert(PID);
+    someFields.insert(MinFlt);
+    someFields.insert(CurCPUPerc);
+    someFields.insert(VmRSSkB);
+    someFields.insert(IntervalSecs);
+    const std::vector<int> someColumns = CsvOutput(std::cout, someFields).getColumns();
+    assert(BinaryFormat::recordSize(someColumns) < BinaryFormat::recordSize(allColumns));
+
+    ProcessStatus partial = fullStatus(3);
+    partial.valid = 0;
+    partial.setValid(PID);
+    partial.setValid(MinFlt);
+    partial.setValid(CurCPUPerc);
+    partial.setValid(TotReadBytes); // not among the columns
+    const ProcessStatus decodedPartial = roundTrip(someColumns, ts, partial);
+    assert(!decodedPartial.isValid(Name) && !decodedPartial.isValid(TotReadBytes));
+    assert(csv(someFields, ts, decodedPartial) == csv(someFields, ts, partial));
+
+    ProcessStatus empty = ProcessStatus();
+    const ProcessStatus decodedEmpty = roundTrip(someColumns, TimeSpec(), empty);
+    assert(decodedEmpty.valid == 0);
+    assert(csv(someFields, TimeSpec(), decodedEmpty) == csv(someFields, TimeSpec(), empty));
+}
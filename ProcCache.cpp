@@ -1,23 +1,24 @@
 #include "ProcCache.h"
 #include "ProcReader.h"
-#include "helper.h"
 
 Cache::Cache() : isEmpty(true),
   userTimeJiffies(0), systemTimeJiffies(0), startTimeJiffies(0), runTimeSecs(0.0),
   totReadBytes(0), totReadBytesStorage(0), totWrittenBytes(0), totWrittenBytesStorage(0),
-  totReadCalls(0), totWriteCalls(0) {
+  totReadCalls(0), totWriteCalls(0), cpuTimeNs(0), runQueueWaitNs(0) {
 }
 
 Cache::Cache(const ProcessStatus& status) :
   isEmpty(false),
-  userTimeJiffies(stringToNumber<uint64_t>(status[UserTimeJiffies])),
-  systemTimeJiffies(stringToNumber<uint64_t>(status[SystemTimeJiffies])),
-  startTimeJiffies(stringToNumber<uint64_t>(status[StartTimeJiffies])),
+  userTimeJiffies(status.values[UserTimeJiffies].u),
+  systemTimeJiffies(status.values[SystemTimeJiffies].u),
+  startTimeJiffies(status.values[StartTimeJiffies].u),
   runTimeSecs(0.0),
-  totReadBytes(stringToNumber<uint64_t>(status[TotReadBytes])),
-  totReadBytesStorage(stringToNumber<uint64_t>(status[TotReadBytesStorage])),
-  totWrittenBytes(stringToNumber<uint64_t>(status[TotWrittenBytes])),
-  totWrittenBytesStorage(stringToNumber<uint64_t>(status[TotWrittenBytesStorage])),
-  totReadCalls(stringToNumber<uint64_t>(status[TotReadCalls])),
-  totWriteCalls(stringToNumber<uint64_t>(status[TotWriteCalls])) {
+  totReadBytes(status.values[TotReadBytes].u),
+  totReadBytesStorage(status.values[TotReadBytesStorage].u),
+  totWrittenBytes(status.values[TotWrittenBytes].u),
+  totWrittenBytesStorage(status.values[TotWrittenBytesStorage].u),
+  totReadCalls(status.values[TotReadCalls].u),
+  totWriteCalls(status.values[TotWriteCalls].u),
+  cpuTimeNs(status.values[CPUTimeNs].u),
+  runQueueWaitNs(status.values[RunQueueWaitNs].u) {
 }
@@ -2,19 +2,17 @@
 #define PROC_CACHE_H PROC_CACHE_H
 
 #include <cstdint>
-#include <string>
-#include <vector>
 
-typedef std::vector<std::string> ProcessStatus;
+struct ProcessStatus;
 
-/// cached values from a @ref processStatus in order to
-/// reduce expensive string-number-string conversions
+/// values from a @ref ProcessStatus which are needed
+/// in the next iteration for calculating current values
 class Cache {
   public:
     /// creates an empty cache
     Cache();
 
-    /// creates a cache from a @ref processStatus
+    /// creates a cache from a @ref ProcessStatus
     /// @note @ref runTimeSecs has to be filled later
     Cache(const ProcessStatus &status);
 
@@ -29,6 +27,8 @@ class Cache {
     uint64_t totWrittenBytesStorage;
     uint64_t totReadCalls;
     uint64_t totWriteCalls;
+    uint64_t cpuTimeNs;
+    uint64_t runQueueWaitNs;
 };
 
 #endif // PROC_CACHE_H
@@ -0,0 +1,204 @@
+#include "ProcEventListener.h"
+#include "definitions.h"
+
+#include <iostream>
+#include <cassert>
+#include <cstring>
+
+#include <errno.h>
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+// size of the socket receive buffer, events get lost if it overflows between two iterations
+static const int receiveBufferSize = 4 * 1024 * 1024;
+
+// maximum time to wait for the process connector to acknowledge a subscription
+static const int ackTimeoutMs = 1000;
+
+ProcEventListener::ProcEventListener() : sock(-1) {
+}
+
+ProcEventListener::~ProcEventListener() {
+    if (sock != -1) {
+        sendMulticastOp(PROC_CN_MCAST_IGNORE);
+        close(sock);
+    }
+}
+
+bool ProcEventListener::open() {
+    assert(sock == -1);
+
+    sock = socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_CONNECTOR);
+    if (sock == -1) {
+        std::cerr << "could not open netlink connector socket: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    // try to get a large receive buffer, bursts of process creation may overflow it otherwise
+    if (setsockopt(sock, SOL_SOCKET, SO_RCVBUFFORCE, &receiveBufferSize, sizeof(receiveBufferSize)) == -1) {
+        setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &receiveBufferSize, sizeof(receiveBufferSize));
+    }
+
+    struct sockaddr_nl addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = CN_IDX_PROC;
+    if (bind(sock, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == -1) {
+        std::cerr << "could not bind netlink connector socket: " << strerror(errno) << std::endl;
+        close(sock);
+        sock = -1;
+        return false;
+    }
+
+    if (!sendMulticastOp(PROC_CN_MCAST_LISTEN)) {
+        std::cerr << "could not subscribe to process events: " << strerror(errno) << std::endl;
+        close(sock);
+        sock = -1;
+        return false;
+    }
+
+    // sending succeeds even if the subscription is refused, e.g. without CAP_NET_ADMIN
+    const int err = receiveAck();
+    if (err != 0) {
+        std::cerr << "could not subscribe to process events: " << strerror(err) << std::endl;
+        close(sock);
+        sock = -1;
+        return false;
+    }
+
+    return true;
+}
+
+bool ProcEventListener::sendMulticastOp(const int op) {
+    const enum proc_cn_mcast_op mcastOp = static_cast<enum proc_cn_mcast_op>(op);
+
+    char buf[NLMSG_SPACE(sizeof(struct cn_msg) + sizeof(mcastOp))];
+    memset(buf, 0, sizeof(buf));
+
+    struct nlmsghdr* hdr = reinterpret_cast<struct nlmsghdr*>(buf);
+    hdr->nlmsg_len  = NLMSG_LENGTH(sizeof(struct cn_msg) + sizeof(mcastOp));
+    hdr->nlmsg_type = NLMSG_DONE;
+    hdr->nlmsg_pid  = getpid();
+
+    struct cn_msg* msg = reinterpret_cast<struct cn_msg*>(NLMSG_DATA(hdr));
+    msg->id.idx = CN_IDX_PROC;
+    msg->id.val = CN_VAL_PROC;
+    msg->ack    = getpid(); // acknowledged with ack + 1 to all listeners, identifies our acknowledgement
+    msg->len    = sizeof(mcastOp);
+    memcpy(msg->data, &mcastOp, sizeof(mcastOp));
+
+    return send(sock, buf, hdr->nlmsg_len, 0) != -1;
+}
+
+int ProcEventListener::receiveAck() {
+    char buf[8192] __attribute__((aligned(NLMSG_ALIGNTO)));
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    const int64_t deadlineMs = now.tv_sec * 1000LL + now.tv_nsec / 1000000 + ackTimeoutMs;
+
+    for (;;) {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        const int64_t remainingMs = deadlineMs - (now.tv_sec * 1000LL + now.tv_nsec / 1000000);
+        if (remainingMs <= 0) {
+            return ETIMEDOUT;
+        }
+
+        struct pollfd pfd;
+        pfd.fd      = sock;
+        pfd.events  = POLLIN;
+        pfd.revents = 0;
+        const int ready = poll(&pfd, 1, remainingMs);
+        if (ready == -1 && errno != EINTR) {
+            return errno;
+        }
+        if (ready <= 0) continue;
+
+        int len = recv(sock, buf, sizeof(buf), 0);
+        if (len == -1) {
+            if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) continue;
+            return errno;
+        }
+
+        for (struct nlmsghdr* hdr = reinterpret_cast<struct nlmsghdr*>(buf);
+             NLMSG_OK(hdr, len); hdr = NLMSG_NEXT(hdr, len)) {
+            if (hdr->nlmsg_type == NLMSG_ERROR) {
+                const struct nlmsgerr* nlErr = reinterpret_cast<const struct nlmsgerr*>(NLMSG_DATA(hdr));
+                if (nlErr->error != 0) return -nlErr->error;
+                continue;
+            }
+
+            const struct cn_msg* msg = reinterpret_cast<const struct cn_msg*>(NLMSG_DATA(hdr));
+            if (msg->id.idx != CN_IDX_PROC || msg->id.val != CN_VAL_PROC) continue;
+            if (msg->ack != (uint32_t)getpid() + 1) continue; // acknowledgement of another listener
+
+            const struct proc_event* event = reinterpret_cast<const struct proc_event*>(msg->data);
+            if (event->what == proc_event::PROC_EVENT_NONE) {
+                return event->event_data.ack.err;
+            }
+        }
+    }
+}
+
+bool ProcEventListener::receive(ProcEventList& events) {
+    assert(sock != -1);
+
+    char buf[8192] __attribute__((aligned(NLMSG_ALIGNTO)));
+    bool complete = true;
+
+    for (;;) {
+        int len = recv(sock, buf, sizeof(buf), 0);
+        if (len == -1) {
+            if (errno == EINTR) {
+                continue;
+            } else if (errno == ENOBUFS) {
+                complete = false; // receive buffer has overflown, events have been dropped
+                continue;
+            } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                std::cerr << "could not receive process events: " << strerror(errno) << std::endl;
+                complete = false;
+            }
+            break; // no more events pending
+        }
+
+        for (struct nlmsghdr* hdr = reinterpret_cast<struct nlmsghdr*>(buf);
+             NLMSG_OK(hdr, len); hdr = NLMSG_NEXT(hdr, len)) {
+            if (unlikely(hdr->nlmsg_type == NLMSG_ERROR || hdr->nlmsg_type == NLMSG_NOOP))
+                continue;
+
+            const struct cn_msg* msg = reinterpret_cast<const struct cn_msg*>(NLMSG_DATA(hdr));
+            if (unlikely(msg->id.idx != CN_IDX_PROC || msg->id.val != CN_VAL_PROC))
+                continue;
+
+            const struct proc_event* event = reinterpret_cast<const struct proc_event*>(msg->data);
+            switch (event->what) {
+                case proc_event::PROC_EVENT_FORK:
+                    // ignore new threads
+                    if (event->event_data.fork.child_pid == event->event_data.fork.child_tgid) {
+                        events.push_back(ProcEvent(ProcEvent::Fork, event->event_data.fork.child_tgid,
+                                                   event->event_data.fork.parent_tgid));
+                    }
+                    break;
+                case proc_event::PROC_EVENT_EXEC:
+                    events.push_back(ProcEvent(ProcEvent::Exec, event->event_data.exec.process_tgid, -1));
+                    break;
+                case proc_event::PROC_EVENT_EXIT:
+                    // ignore terminating threads
+                    if (event->event_data.exit.process_pid == event->event_data.exit.process_tgid) {
+                        events.push_back(ProcEvent(ProcEvent::Exit, event->event_data.exit.process_tgid,
+                                                   event->event_data.exit.parent_tgid));
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+    return complete;
+}
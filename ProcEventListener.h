@@ -0,0 +1,61 @@
+#ifndef PROC_EVENT_LISTENER_H
+#define PROC_EVENT_LISTENER_H PROC_EVENT_LISTENER_H
+
+#include <vector>
+
+/// a process event reported by the kernel
+/// @note events of threads other than the main thread are not reported
+class ProcEvent {
+  public:
+    typedef enum {
+        Fork, ///< process has been created
+        Exec, ///< process has executed a new program
+        Exit  ///< process has been terminated
+    } Type;
+
+    ProcEvent(const Type eventType, const int processID, const int parentID) :
+      type(eventType), pid(processID), ppid(parentID) {}
+
+    Type type; ///< type of the event
+    int  pid;  ///< PID of the process
+    int  ppid; ///< PID of the parent process, -1 if not reported
+};
+
+typedef std::vector<ProcEvent> ProcEventList;
+
+/// receives process events from the kernel's netlink process connector,
+/// allows tracking processes without rescanning /proc in every iteration
+/// @note usually requires root privileges or the CAP_NET_ADMIN capability
+class ProcEventListener {
+  public:
+    ProcEventListener();
+    ~ProcEventListener();
+
+    /// opens the netlink socket and subscribes to process events
+    /// @return false if process events are not available, an error message has been printed then
+    bool open();
+
+    /// returns whether we are subscribed to process events
+    bool isOpen() const { return sock != -1; }
+
+    /// receives all pending events without blocking and appends them to @p events
+    /// @return false if events have been lost, e.g. because the receive buffer has overflown
+    bool receive(ProcEventList& events);
+
+  private:
+    // not copyable, owns the socket
+    ProcEventListener(const ProcEventListener& other);
+    ProcEventListener& operator=(const ProcEventListener& other);
+
+    /// sends a (un)subscribe request to the process connector
+    bool sendMulticastOp(const int op);
+
+    /// waits for the process connector to acknowledge the request sent by @ref sendMulticastOp(),
+    /// events received in the meantime are dropped
+    /// @return 0 if the request has succeeded, an error number otherwise, e.g. EPERM without CAP_NET_ADMIN
+    int receiveAck();
+
+    int sock; ///< netlink socket, -1 if not open
+};
+
+#endif // PROC_EVENT_LISTENER_H
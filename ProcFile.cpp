@@ -0,0 +1,115 @@
+#include "ProcFile.h"
+#include "definitions.h"
+
+#include <cassert>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// initial size of a new read buffer, large enough for most /proc/pid/status files
+static const size_t initialBufferSize = 4096;
+
+unsigned int ProcFile::maxOpenFiles = 0;
+unsigned int ProcFile::openFiles    = 0;
+
+ProcFile::ProcFile(const std::string& filePath) : path(filePath), fd(-1), failed(false) {
+    assert(!path.empty());
+}
+
+ProcFile::ProcFile(const ProcFile& other) : path(other.path), fd(-1), failed(other.failed) {
+}
+
+ProcFile::~ProcFile() {
+    close();
+}
+
+ProcFile& ProcFile::operator=(const ProcFile& other) {
+    if (this != &other) {
+        close();
+        path   = other.path;
+        failed = other.failed;
+    }
+    return *this;
+}
+
+ssize_t ProcFile::read(ReadBuffer& buffer) {
+    if (buffer.size() < initialBufferSize)
+        buffer.resize(initialBufferSize);
+
+    if (unlikely(failed))
+        return -1;
+
+    // open file if not done yet, keep it open only if we are below our limit
+    bool keepOpen = true;
+    if (fd == -1) {
+        fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (unlikely(fd == -1)) {
+            failed = true; // process may already have been terminated
+            return -1;
+        }
+        // files may be read by multiple threads, update counter atomically
+        keepOpen = __sync_add_and_fetch(&openFiles, 1) <= maxOpenFiles;
+        if (!keepOpen)
+            __sync_sub_and_fetch(&openFiles, 1);
+    }
+
+    // read whole file, enlarge buffer if it was too small
+    ssize_t len;
+    while ((len = pread(fd, &buffer[0], buffer.size() - 1, 0)) == (ssize_t)buffer.size() - 1) {
+        buffer.resize(buffer.size() * 2);
+    }
+
+    if (!keepOpen) {
+        ::close(fd);
+        fd = -1;
+    }
+
+    if (unlikely(len <= 0)) {
+        failed = true; // process has been terminated, read() fails with ESRCH then
+        return -1;
+    }
+
+    buffer[len] = '\0';
+    return len;
+}
+
+int ProcFile::descriptor() {
+    if (unlikely(failed))
+        return -1;
+
+    if (fd == -1) {
+        // never exceed our limit, the file will be read via read() then
+        if (__sync_add_and_fetch(&openFiles, 1) > maxOpenFiles) {
+            __sync_sub_and_fetch(&openFiles, 1);
+            return -1;
+        }
+        fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (unlikely(fd == -1)) {
+            __sync_sub_and_fetch(&openFiles, 1);
+            failed = true; // process may already have been terminated
+            return -1;
+        }
+    }
+
+    return fd;
+}
+
+void ProcFile::close() {
+    if (fd == -1)
+        return;
+
+    ::close(fd);
+    fd = -1;
+    assert(openFiles > 0);
+    __sync_sub_and_fetch(&openFiles, 1);
+}
+
+ProcFiles::ProcFiles(const std::string& processID) : pid(0), thread(false),
+  stat(procRoot() + "/" + processID + "/stat"), status(procRoot() + "/" + processID + "/status"),
+  io(procRoot() + "/" + processID + "/io"), schedStat(procRoot() + "/" + processID + "/schedstat") {
+    // taskstats has to be queried for the TID of a thread
+    const size_t sep = processID.rfind('/');
+    thread = (sep != std::string::npos);
+    pid = atoi(processID.c_str() + (thread ? sep + 1 : 0));
+}
@@ -0,0 +1,82 @@
+#ifndef PROC_FILE_H
+#define PROC_FILE_H PROC_FILE_H
+
+#include "helper.h"
+
+#include <string>
+#include <cstdlib>
+#include <vector>
+
+#include <sys/types.h>
+
+/// reusable buffer files from /proc are read into
+/// @note always NUL-terminated after a successful @ref ProcFile::read()
+typedef std::vector<char> ReadBuffer;
+
+/// a file below /proc/pid/ which is kept open for the lifetime of the watched process
+/// and re-read via pread() in each iteration instead of being opened and closed again
+/// @note the file is opened lazily on the first read, copies do not share the
+///       file descriptor but will open their own one
+class ProcFile {
+  public:
+    /// creates a file object for the given path, doesn't open it yet
+    ProcFile(const std::string& filePath);
+    ProcFile(const ProcFile& other);
+    ~ProcFile();
+
+    ProcFile& operator=(const ProcFile& other);
+
+    /// reads the whole file into @p buffer, opens the file if required
+    /// @return number of bytes read or -1 on error (e.g. process has been terminated)
+    ssize_t read(ReadBuffer& buffer);
+
+    /// returns whether the file can still be read, false after the first failed open or read
+    bool isReadable() const { return !failed; }
+
+    /// opens the file if required and returns its descriptor for reading it elsewhere,
+    /// e.g. in a batch via io_uring, -1 if it cannot be kept open or has failed before
+    int descriptor();
+
+    /// marks the file as failed after reading it elsewhere has failed
+    void setFailed() { failed = true; }
+
+    /// sets the maximum number of files we keep open at the same time,
+    /// files exceeding this limit will be opened and closed on every read
+    static void setMaxOpenFiles(const unsigned int maxFiles) { maxOpenFiles = maxFiles; }
+
+  private:
+    /// closes the file if it is open
+    void close();
+
+    std::string path;   ///< path of the file
+    int         fd;     ///< file descriptor, -1 if not (yet) opened
+    bool        failed; ///< whether opening or reading has failed
+
+    static unsigned int maxOpenFiles; ///< maximum number of persistently opened files
+    static unsigned int openFiles;    ///< current number of persistently opened files
+};
+
+/// files read per process, see @ref ProcFiles
+enum ProcFileKind {
+    FileStat = 0,
+    FileStatus,
+    FileIO,
+    FileSchedStat,
+    FileKindCount
+};
+
+/// all files of a process we are reading from /proc/pid/, or of a single thread from /proc/pid/task/tid/
+class ProcFiles {
+  public:
+    /// creates the file objects for the given PID, 'PID/task/TID' for a single thread
+    ProcFiles(const std::string& processID);
+
+    int      pid;    ///< PID the files belong to, the TID for a single thread
+    bool     thread; ///< whether the files belong to a single thread
+    ProcFile stat;   ///< /proc/pid/stat
+    ProcFile status; ///< /proc/pid/status
+    ProcFile io;     ///< /proc/pid/io
+    ProcFile schedStat; ///< /proc/pid/schedstat
+};
+
+#endif // PROC_FILE_H
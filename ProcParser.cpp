@@ -0,0 +1,193 @@
+#include "ProcParser.h"
+#include "definitions.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <cstring>
+
+namespace {
+
+/// marks a field we are not interested in
+const int skipField = -1;
+
+/// fields of /proc/pid/stat following the executable name, see proc(5)
+const int statFields[] = {
+    State, PPID, PGRP, skipField /* session */, skipField /* tty_nr */, skipField /* tpgid */,
+    skipField /* flags */, MinFlt, skipField /* cminflt */, MajFlt, skipField /* cmajflt */,
+    UserTimeJiffies, SystemTimeJiffies, skipField /* cutime */, skipField /* cstime */,
+    Priority, Nice, Threads, skipField /* itrealvalue */, StartTimeJiffies, skipField /* vsize */,
+    skipField /* rss */, skipField /* rsslim */, skipField /* startcode */, skipField /* endcode */,
+    skipField /* startstack */, skipField /* kstkesp */, skipField /* kstkeip */, skipField /* signal */,
+    skipField /* blocked */, skipField /* sigignore */, skipField /* sigcatch */, skipField /* wchan */,
+    skipField /* nswap */, skipField /* cnswap */, skipField /* exit_signal */, LastCPU /* processor */
+};
+const size_t statFieldCount = sizeof(statFields) / sizeof(statFields[0]);
+
+/// fields of /proc/pid/schedstat, see sched-stats.rst in the kernel documentation
+const int schedStatFields[] = { CPUTimeNs, RunQueueWaitNs, Timeslices };
+const size_t schedStatFieldCount = sizeof(schedStatFields) / sizeof(schedStatFields[0]);
+
+/// maps a key from a "key: value" line to a status column
+struct KeyColumn {
+    const char* key;    ///< key without the trailing colon
+    size_t      keyLen; ///< length of @ref key
+    int         column; ///< column the value belongs to
+};
+
+/// keys from /proc/pid/status we are interested in
+const KeyColumn statusKeys[] = {
+    {"VmPeak", 6, VmPeakkB}, {"VmSize", 6, VmSizekB}, {"VmLck", 5, VmLckkB},
+    {"VmHWM",  5, VmHWMkB},  {"VmRSS",  5, VmRSSkB},  {"VmSwap", 6, VmSwapkB}
+};
+const size_t statusKeyCount = sizeof(statusKeys) / sizeof(statusKeys[0]);
+
+/// keys from /proc/pid/io we are interested in
+const KeyColumn ioKeys[] = {
+    {"rchar", 5, TotReadBytes},           {"wchar", 5, TotWrittenBytes},
+    {"syscr", 5, TotReadCalls},           {"syscw", 5, TotWriteCalls},
+    {"read_bytes", 10, TotReadBytesStorage}, {"write_bytes", 11, TotWrittenBytesStorage}
+};
+const size_t ioKeyCount = sizeof(ioKeys) / sizeof(ioKeys[0]);
+
+/// returns the column belonging to @p key or @ref skipField if unknown
+inline int lookupKey(const KeyColumn* keys, const size_t keyCount, const char* key, const size_t keyLen) {
+    for (size_t i = 0; i < keyCount; ++i) {
+        if (keys[i].keyLen == keyLen && keys[i].key[0] == key[0] &&
+            memcmp(keys[i].key, key, keyLen) == 0) {
+            return keys[i].column;
+        }
+    }
+    return skipField;
+}
+
+/// returns the end of the token starting at @p pos, i.e. the next whitespace or @p end
+inline const char* tokenEnd(const char* pos, const char* end) {
+    while (pos != end && *pos != ' ' && *pos != '\t' && *pos != '\n')
+        ++pos;
+    return pos;
+}
+
+/// parses the number from @p pos up to @p end and stores it in @p column according to its type
+inline void parseValue(const char* pos, const char* end, const int column, ProcessStatus& status) {
+    switch (statusColumnType[column]) {
+        case ColumnChar:
+            status.setInteger(column, *pos);
+            break;
+        case ColumnInteger: {
+            const bool negative = (*pos == '-');
+            if (negative)
+                ++pos;
+            int64_t number = 0;
+            for (; pos != end; ++pos)
+                number = number * 10 + (*pos - '0');
+            status.setInteger(column, negative ? -number : number);
+            break;
+        }
+        case ColumnCounter: {
+            uint64_t number = 0;
+            for (; pos != end; ++pos)
+                number = number * 10 + (*pos - '0');
+            status.setCounter(column, number);
+            break;
+        }
+        default:
+            assert(false); // text and real values are not read from /proc
+            break;
+    }
+}
+
+/// parses "key: value" lines and stores the values of all @p keys
+/// @return number of keys found
+size_t parseKeyValueLines(const char* buf, const size_t len,
+                          const KeyColumn* keys, const size_t keyCount, ProcessStatus& status) {
+    const char* pos = buf;
+    const char* end = buf + len;
+    size_t found = 0;
+
+    while (pos < end && found < keyCount) {
+        const char* lineEnd = static_cast<const char*>(memchr(pos, '\n', end - pos));
+        if (!lineEnd)
+            lineEnd = end;
+
+        const char* colon = static_cast<const char*>(memchr(pos, ':', lineEnd - pos));
+        if (likely(colon != NULL)) {
+            const int column = lookupKey(keys, keyCount, pos, colon - pos);
+            if (column != skipField) {
+                const char* value = colon + 1;
+                while (value != lineEnd && (*value == ' ' || *value == '\t'))
+                    ++value;
+                if (likely(value != lineEnd)) {
+                    parseValue(value, tokenEnd(value, lineEnd), column, status);
+                    ++found;
+                }
+            }
+        }
+
+        pos = lineEnd + 1;
+    }
+
+    return found;
+}
+
+} // namespace
+
+bool ProcParser::parseStat(const char* buf, const size_t len, ProcessStatus& status) {
+    const char* end = buf + len;
+
+    // first field is the PID, the TID for threads
+    const char* pidEnd = tokenEnd(buf, end);
+    if (unlikely(pidEnd == buf || pidEnd == end))
+        return false;
+    parseValue(buf, pidEnd, PID, status);
+    status.setInteger(TID, status.values[PID].i);
+
+    // second field is the executable name in brackets, may contain spaces and other bad characters
+    // example name from readproc.c ":-) 1 2 3 4 5 6" -> reverse search for closing bracket ')'
+    const char* nameStart = pidEnd + 2;
+    const char* nameEnd = static_cast<const char*>(memrchr(buf, ')', len));
+    if (unlikely(nameStart > end || nameEnd == NULL || nameEnd < nameStart))
+        return false;
+    const size_t nameLen = std::min((size_t)(nameEnd - nameStart), maxNameLength - 1);
+    memcpy(status.name, nameStart, nameLen);
+    status.name[nameLen] = '\0';
+    status.setValid(Name);
+
+    // remaining fields are separated by single spaces
+    const char* pos = nameEnd + 2;
+    for (size_t field = 0; field < statFieldCount; ++field) {
+        if (unlikely(pos >= end))
+            return false;
+        const char* fieldEnd = tokenEnd(pos, end);
+        if (statFields[field] != skipField) {
+            parseValue(pos, fieldEnd, statFields[field], status);
+        }
+        pos = fieldEnd + 1;
+    }
+
+    return true;
+}
+
+bool ProcParser::parseStatus(const char* buf, const size_t len, ProcessStatus& status) {
+    // kernel threads don't have any memory-related information, nothing to find is fine
+    parseKeyValueLines(buf, len, statusKeys, statusKeyCount, status);
+    return true;
+}
+
+bool ProcParser::parseIO(const char* buf, const size_t len, ProcessStatus& status) {
+    return parseKeyValueLines(buf, len, ioKeys, ioKeyCount, status) == ioKeyCount;
+}
+
+bool ProcParser::parseSchedStat(const char* buf, const size_t len, ProcessStatus& status) {
+    const char* pos = buf;
+    const char* end = buf + len;
+    for (size_t field = 0; field < schedStatFieldCount; ++field) {
+        if (unlikely(pos >= end || !isdigit(*pos)))
+            return false;
+        const char* fieldEnd = tokenEnd(pos, end);
+        parseValue(pos, fieldEnd, schedStatFields[field], status);
+        pos = fieldEnd + 1;
+    }
+
+    return true;
+}
@@ -0,0 +1,29 @@
+#ifndef PROC_PARSER_H
+#define PROC_PARSER_H PROC_PARSER_H
+
+#include "ProcReader.h"
+
+#include <cstddef>
+
+/// parsers for the contents of /proc/pid/stat, /proc/pid/status, /proc/pid/io and /proc/pid/schedstat
+/// @note all parsers work in a single pass on the raw buffer and don't allocate memory,
+///       only the columns found are set in @p status
+namespace ProcParser {
+    /// parses the contents of /proc/pid/stat
+    /// @return false if the contents could not be parsed
+    bool parseStat(const char* buf, const size_t len, ProcessStatus& status);
+
+    /// parses the memory-related information from the contents of /proc/pid/status
+    /// @return false if the contents could not be parsed
+    bool parseStatus(const char* buf, const size_t len, ProcessStatus& status);
+
+    /// parses the contents of /proc/pid/io
+    /// @return false if the contents could not be parsed
+    bool parseIO(const char* buf, const size_t len, ProcessStatus& status);
+
+    /// parses the contents of /proc/pid/schedstat
+    /// @return false if the contents could not be parsed
+    bool parseSchedStat(const char* buf, const size_t len, ProcessStatus& status);
+}
+
+#endif // PROC_PARSER_H
@@ -0,0 +1,159 @@
+#include "ProcParser.h"
+
+#include <string>
+#include <cassert>
+
+/// parser function of @ref ProcParser
+typedef bool (*Parser)(const char* buf, const size_t len, ProcessStatus& status);
+
+/// parses the first @p len bytes of @p text from a buffer of exactly that size into a fresh @p status
+static bool parse(Parser parser, const std::string& text, const size_t len, ProcessStatus& status) {
+    const std::string buf = text.substr(0, len);
+    status = ProcessStatus();
+    return parser(buf.data(), buf.size(), status);
+}
+
+/// parses all of @p text
+static bool parse(Parser parser, const std::string& text, ProcessStatus& status) {
+    return parse(parser, text, text.size(), status);
+}
+
+/// returns the bitmask of the given columns, terminated by -1
+static uint64_t columnMask(const int* columns) {
+    uint64_t mask = 0;
+    for (; *columns != -1; ++columns) {
+        mask |= (uint64_t)1 << *columns;
+    }
+    return mask;
+}
+
+static void testStat() {
+    ProcessStatus status;
+
+    // a regular process, the name contains spaces and closing brackets
+    const std::string stat =
+        "1234 (my ) prog)) S 1 1230 1230 0 -1 4194304 80 2 5 0 7 3 0 0 20 0 4 0 747039 2703360 301 "
+        "18446744073709551615 1 1 0 0 0 0 0 0 0 0 0 0 17 3 0 0 0 0 0 1 1 1 1 1 1 1 0\n";
+    assert(parse(ProcParser::parseStat, stat, status));
+    assert(std::string(status.name) == "my ) prog)");
+    assert(status.values[PID].i == 1234 && status.values[TID].i == 1234);
+    assert(status.values[State].i == 'S');
+    assert(status.values[PPID].i == 1 && status.values[PGRP].i == 1230);
+    assert(status.values[MinFlt].u == 80 && status.values[MajFlt].u == 5);
+    assert(status.values[UserTimeJiffies].u == 7 && status.values[SystemTimeJiffies].u == 3);
+    assert(status.values[Priority].i == 20 && status.values[Nice].i == 0);
+    assert(status.values[Threads].i == 4);
+    assert(status.values[StartTimeJiffies].u == 747039);
+    assert(status.values[LastCPU].i == 3);
+    const int statColumns[] = {
+        Name, State, PID, PPID, PGRP, MinFlt, MajFlt, UserTimeJiffies, SystemTimeJiffies, Priority, Nice,
+        Threads, StartTimeJiffies, TID, LastCPU, -1
+    };
+    assert(status.valid == columnMask(statColumns));
+
+    // every truncation before the last field we are interested in is rejected
+    const size_t lastCPUPos = stat.find(" 17 3 ") + 4;
+    for (size_t len = 0; len <= lastCPUPos; ++len) {
+        assert(!parse(ProcParser::parseStat, stat, len, status));
+    }
+    for (size_t len = lastCPUPos + 1; len <= stat.size(); ++len) {
+        assert(parse(ProcParser::parseStat, stat, len, status));
+        assert(status.values[LastCPU].i == 3);
+    }
+
+    // real-time priority and negative nice value
+    const std::string rtStat =
+        "77 (rt) R 1 77 77 0 -1 0 0 0 0 0 0 0 0 0 -51 -5 1 0 10 0 0 "
+        "18446744073709551615 0 0 0 0 0 0 0 0 0 0 0 0 17 0 0 0 0 0 0 0 0 0 0 0 0 0 0\n";
+    assert(parse(ProcParser::parseStat, rtStat, status));
+    assert(status.values[Priority].i == -51 && status.values[Nice].i == -5);
+    assert(status.values[State].i == 'R');
+
+    // kernel threads have no process group, their names may exceed the usual 16 characters
+    const std::string longName(maxNameLength + 10, 'k');
+    const std::string kthreadStat =
+        "2 (" + longName + ") S 0 0 0 0 -1 2129984 0 0 0 0 0 0 0 0 20 0 1 0 8 0 0 "
+        "18446744073709551615 0 0 0 0 0 0 0 2147483647 0 0 0 0 17 1 0 0 0 0 0 0 0 0 0 0 0 0 0\n";
+    assert(parse(ProcParser::parseStat, kthreadStat, status));
+    assert(std::string(status.name) == longName.substr(0, maxNameLength - 1));
+    assert(status.values[PPID].i == 0 && status.values[PGRP].i == 0);
+    assert(status.values[LastCPU].i == 1);
+
+    // an empty name is fine, missing brackets are not
+    assert(parse(ProcParser::parseStat, "5 () S" + stat.substr(stat.find(") S ") + 3), status));
+    assert(status.name[0] == '\0' && status.values[PPID].i == 1);
+    assert(!parse(ProcParser::parseStat, "5 name S 1 5 5\n", status));
+    assert(!parse(ProcParser::parseStat, "", status));
+}
+
+static void testStatus() {
+    ProcessStatus status;
+
+    const std::string processStatus =
+        "Name:\tcat\nUmask:\t0022\nState:\tR (running)\nTgid:\t28106\nVmPeak:\t    2640 kB\n"
+        "VmSize:\t    2636 kB\nVmLck:\t       0 kB\nVmPin:\t       0 kB\nVmHWM:\t    1208 kB\n"
+        "VmRSS:\t    1204 kB\nRssAnon:\t      88 kB\nVmData:\t     360 kB\nVmSwap:\t      12 kB\n"
+        "Threads:\t1\n";
+    assert(parse(ProcParser::parseStatus, processStatus, status));
+    assert(status.values[VmPeakkB].u == 2640 && status.values[VmSizekB].u == 2636);
+    assert(status.values[VmLckkB].u == 0 && status.values[VmHWMkB].u == 1208);
+    assert(status.values[VmRSSkB].u == 1204 && status.values[VmSwapkB].u == 12);
+    const int memoryColumns[] = { VmPeakkB, VmSizekB, VmLckkB, VmHWMkB, VmRSSkB, VmSwapkB, -1 };
+    assert(status.valid == columnMask(memoryColumns));
+
+    // kernel threads have no memory-related keys at all, which is not an error
+    const std::string kthreadStatus = "Name:\tkthreadd\nUmask:\t0000\nState:\tS (sleeping)\nThreads:\t1\n";
+    assert(parse(ProcParser::parseStatus, kthreadStatus, status));
+    assert(status.valid == 0);
+
+    // keys missing due to truncation are left unset
+    const size_t swapPos = processStatus.find("VmSwap");
+    assert(parse(ProcParser::parseStatus, processStatus, swapPos + 4, status));
+    assert(!status.isValid(VmSwapkB) && status.isValid(VmRSSkB));
+    assert(parse(ProcParser::parseStatus, processStatus, 0, status));
+    assert(status.valid == 0);
+}
+
+static void testIO() {
+    ProcessStatus status;
+
+    const std::string io =
+        "rchar: 3980\nwchar: 17\nsyscr: 9\nsyscw: 2\nread_bytes: 4096\nwrite_bytes: 8192\n"
+        "cancelled_write_bytes: 0\n";
+    assert(parse(ProcParser::parseIO, io, status));
+    assert(status.values[TotReadBytes].u == 3980 && status.values[TotWrittenBytes].u == 17);
+    assert(status.values[TotReadCalls].u == 9 && status.values[TotWriteCalls].u == 2);
+    assert(status.values[TotReadBytesStorage].u == 4096 && status.values[TotWrittenBytesStorage].u == 8192);
+    const int ioColumns[] = {
+        TotReadBytes, TotWrittenBytes, TotReadCalls, TotWriteCalls, TotReadBytesStorage, TotWrittenBytesStorage, -1
+    };
+    assert(status.valid == columnMask(ioColumns));
+
+    // all keys are required, e.g. a truncated file is rejected
+    const size_t lastValuePos = io.find("write_bytes: ") + 13;
+    for (size_t len = 0; len <= lastValuePos; ++len) {
+        assert(!parse(ProcParser::parseIO, io, len, status));
+    }
+    assert(!parse(ProcParser::parseIO, "rchar: 1\nwchar: 2\nsyscr: 3\nsyscw: 4\nread_bytes: 5\n", status));
+}
+
+static void testSchedStat() {
+    ProcessStatus status;
+
+    assert(parse(ProcParser::parseSchedStat, "3870754 120 1\n", status));
+    assert(status.values[CPUTimeNs].u == 3870754);
+    assert(status.values[RunQueueWaitNs].u == 120);
+    assert(status.values[Timeslices].u == 1);
+
+    assert(!parse(ProcParser::parseSchedStat, "", status));
+    assert(!parse(ProcParser::parseSchedStat, "3870754 120", status));
+    assert(!parse(ProcParser::parseSchedStat, "3870754 120 ", status));
+    assert(!parse(ProcParser::parseSchedStat, "none\n", status));
+}
+
+void testProcParser() {
+    testStat();
+    testStatus();
+    testIO();
+    testSchedStat();
+}
@@ -1,10 +1,10 @@
 #include "ProcReader.h"
+#include "ProcParser.h"
+#include "TaskStatsReader.h"
 #include "helper.h"
 #include "definitions.h"
 
-#include <fstream>
 #include <iostream>
-#include <sstream>
 #include <string>
 #include <cassert>
 #include <cctype>
@@ -14,160 +14,287 @@
 #include <dirent.h>
 #include <errno.h>
 
-ProcReader::ProcReader(const std::string& processID) :
-  pid(processID), hasRead(false), status(StatusColumnCount, "0.0"),
-  cache(), canReadStat(false), canReadStatus(false), canReadIO(false) {
-    // perform some checks
-    if (unlikely(!dirExists("/proc/" + pid))) {
+// PID of the kernel thread daemon, parent of all other kernel threads
+static const int kthreaddPID = 2;
+
+ReadPlan::ReadPlan() :
+  taskStats(NULL), readStat(true), readStatus(true), readIO(true), readSchedStat(false), schedStatCPU(false),
+  calcRuntime(true), calcUserSystemTimes(true), calcCPUUtilization(true), calcIOUtilization(true),
+  calcRunQueueWait(false) {
+}
+
+ReadPlan::ReadPlan(const std::set<int>& fields, TaskStatsReader* taskStatsReader, const bool schedStat) :
+  taskStats(taskStatsReader), readStat(taskStatsReader == NULL), readStatus(false), readIO(false), readSchedStat(false),
+  schedStatCPU(schedStat), calcRuntime(false), calcUserSystemTimes(false), calcCPUUtilization(false),
+  calcIOUtilization(false), calcRunQueueWait(false) {
+    if (fields.empty()) {
+        *this = ReadPlan();
+        taskStats = taskStatsReader;
+        // /proc/pid/schedstat is a fourth file per process, only read it if asked for
+        schedStatCPU = readSchedStat = calcRunQueueWait = schedStat;
         return;
     }
 
-    canReadStat   = fileReadable("/proc/" + pid + "/stat");
-    canReadStatus = fileReadable("/proc/" + pid + "/status");
-    canReadIO     = fileReadable("/proc/" + pid + "/io");
+    for (std::set<int>::const_iterator it = fields.begin(); it != fields.end(); ++it) {
+        // columns provided by taskstats don't have to be read from /proc
+        if (taskStats && TaskStatsReader::providesColumn(*it)) {
+            continue;
+        }
+
+        switch (*it) {
+            case AvgCPUPerc:
+            case CurCPUPerc:
+                calcCPUUtilization = true;
+                break;
+            case UserTimePerc:
+            case SystemTimePerc:
+                calcUserSystemTimes = true;
+                break;
+            case RunTimeSecs:
+                calcRuntime = true;
+                break;
+            case VmPeakkB:
+            case VmSizekB:
+            case VmLckkB:
+            case VmHWMkB:
+            case VmRSSkB:
+            case VmSwapkB:
+                readStatus = true;
+                break;
+            case TotReadBytes:
+            case TotReadBytesStorage:
+            case TotWrittenBytes:
+            case TotWrittenBytesStorage:
+            case TotReadCalls:
+            case TotWriteCalls:
+                readIO = true;
+                break;
+            case CurReadBytes:
+            case CurReadBytesStorage:
+            case CurWrittenBytes:
+            case CurWrittenBytesStorage:
+            case CurReadCalls:
+            case CurWriteCalls:
+                readIO = true;
+                calcIOUtilization = true;
+                break;
+            case CPUTimeNs:
+            case RunQueueWaitNs:
+            case Timeslices:
+                readSchedStat = true;
+                break;
+            case CurRunQueueWaitPerc:
+                readSchedStat = true;
+                calcRunQueueWait = true;
+                break;
+            case CPUDelayTotalNs:
+            case BlkIODelayTotalNs:
+            case SwapinDelayTotalNs:
+                break; // only available via taskstats
+            case Processes:
+                break; // only set for process trees
+            case IntervalSecs:
+                break; // set when a process has been read
+            default:
+                readStat = true;
+                break;
+        }
+    }
+
+    // CPU and IO utilization are only calculated if we know the process runtime
+    if (calcCPUUtilization || calcIOUtilization || calcRunQueueWait) {
+        calcRuntime = true;
+    }
+
+    // the number of threads from /proc/pid/stat decides whether schedstat covers all CPU time
+    if (calcCPUUtilization && schedStatCPU) {
+        readSchedStat = true;
+        readStat = true;
+    }
 
-    assert(canReadStat);   // can this fail? where/when?
-    assert(canReadStatus); // can this fail? where/when?
+    // without taskstats we need the start time from /proc/pid/stat for the runtime
+    if (calcRuntime && !taskStats) {
+        readStat = true;
+    }
+}
+
+ReadPlan ReadPlan::restrictTo(const bool* due) const {
+    ReadPlan restricted(*this);
+    restricted.readStat      = readStat      && due[FileStat];
+    restricted.readStatus    = readStatus    && due[FileStatus];
+    restricted.readIO        = readIO        && due[FileIO];
+    restricted.readSchedStat = readSchedStat && due[FileSchedStat];
+    restricted.taskStats     = due[FileStat] ? taskStats : NULL;
+    return restricted;
+}
+
+ProcReader::ProcReader(ProcFiles& procFiles, ReadBuffer& readBuffer, const ReadPlan& readPlan) :
+  files(procFiles), buffer(readBuffer), plan(readPlan), hasRead(false), readFiles(0), status(), cache() {
 }
 
 void ProcReader::readAll() {
-    readProcessStat();
-    readProcessStatus();
-    readProcessIO();
+    if (plan.readStat)
+        readProcessStat();
+    if (plan.taskStats)
+        readTaskStats();
+    if (plan.readStatus)
+        readProcessStatus();
+    if (plan.readIO)
+        readProcessIO();
+    if (plan.readSchedStat)
+        readProcessSchedStat();
+}
+
+void ProcReader::readTaskStats() {
+    assert(plan.taskStats);
+
+    if (unlikely(!plan.taskStats->read(files.pid, status, files.thread))) {
+        return; // process may already have been terminated
+    }
+
+    hasRead = true;
+    readFiles |= 1u << FileStat;
 }
 
 void ProcReader::readProcessStat() {
-    assert(status.size() == StatusColumnCount);
+    const ssize_t len = files.stat.read(buffer);
+    parseProcessStat(&buffer[0], len);
+}
 
-    if (!canReadStat)
-        return;
+void ProcReader::readProcessStatus() {
+    const ssize_t len = files.status.read(buffer);
+    parseProcessStatus(&buffer[0], len);
+}
 
-    const std::string fileName = "/proc/" + pid + "/stat";
-    std::ifstream file(fileName.c_str(), std::ifstream::in);
-    if (unlikely(!file.good())) {
-        canReadStat = false;  // process may already have been terminated
-        return;
-    }
+void ProcReader::readProcessIO() {
+    const ssize_t len = files.io.read(buffer);
+    parseProcessIO(&buffer[0], len);
+}
 
-    std::string line;
-    std::getline(file, line);
-    assert(!line.empty());
+void ProcReader::readProcessSchedStat() {
+    const ssize_t len = files.schedStat.read(buffer);
+    parseProcessSchedStat(&buffer[0], len);
+}
 
-    std::stringstream sstr(line);
+void ProcReader::parseProcessStat(const char* buf, const ssize_t len) {
+    if (unlikely(len == -1)) {
+        return; // process may already have been terminated
+    }
 
-    // read first field
-    sstr >> status[PID];
+    if (unlikely(!ProcParser::parseStat(buf, len, status))) {
+        assert(false);
+        return;
+    }
 
-    // second field is the executable name in brackets, may contain spaces and other bad characters
-    // example name from readproc.c ":-) 1 2 3 4 5 6" -> reverse search for closing bracket ')'
-    const std::string& tmpStr = sstr.str();
-    const size_t cmdStart = tmpStr.find("(") + 1;
-    const size_t cmdEnd   = tmpStr.rfind(")");
-    status[Name] = tmpStr.substr(cmdStart, cmdEnd - cmdStart);
-    assert(!status[Name].empty());
+    hasRead = true;
+    readFiles |= 1u << FileStat;
+}
 
-    // skip first two fields
-    sstr.seekg(cmdEnd + 1);
+void ProcReader::parseProcessStatus(const char* buf, const ssize_t len) {
+    if (unlikely(len == -1)) {
+        return; // process may already have been terminated
+    }
 
-    // remaining fields can be parsed easily as there are no unexpected spaces
-    std::string skip;
-    sstr >> status[State] >> status[PPID] >> status[PGRP]
-         >> skip >> skip >> skip >> skip
-         >> status[MinFlt] >> skip >> status[MajFlt] >> skip
-         >> status[UserTimeJiffies] >> status[SystemTimeJiffies] >> skip >> skip
-         >> status[Priority] >> status[Nice] >> status[Threads]
-         >> skip >> status[StartTimeJiffies];
+    if (unlikely(!ProcParser::parseStatus(buf, len, status))) {
+        return; // we just read some crap
+    }
 
     hasRead = true;
+    readFiles |= 1u << FileStatus;
 }
 
-void ProcReader::readProcessStatus() {
-    assert(status.size() == StatusColumnCount);
+void ProcReader::parseProcessIO(const char* buf, const ssize_t len) {
+    if (unlikely(len == -1)) {
+        return; // process may already have been terminated
+    }
 
-    if (!canReadStatus)
-        return;
+    if (unlikely(!ProcParser::parseIO(buf, len, status))) {
+        return; // we just read some crap
+    }
 
-    const std::string fileName = "/proc/" + pid + "/status";
-    std::ifstream file(fileName.c_str(), std::ifstream::in);
-    if (unlikely(!file.good())) {
-        canReadStatus = false;  // process may already have been terminated
-        return;
+    hasRead = true;
+    readFiles |= 1u << FileIO;
+}
+
+void ProcReader::parseProcessSchedStat(const char* buf, const ssize_t len) {
+    if (unlikely(len == -1)) {
+        return; // process may already have been terminated or kernel lacks CONFIG_SCHED_INFO
     }
 
-    std::string line;
-    while (std::getline(file, line)) {
-        assert(!line.empty());
-        std::stringstream sstr(line);
-        std::string name, value;
-        sstr >> name >> value;
-        if (!sstr) {
-            continue; // we just read some crap
-        }
-        assert(!name.empty());
-        assert(!value.empty() || name == "Groups:");
-
-        if        (name == "VmPeak:") {
-            status[VmPeakkB] = value;
-        } else if (name == "VmSize:") {
-            status[VmSizekB] = value;
-        } else if (name == "VmLck:") {
-            status[VmLckkB] = value;
-        } else if (name == "VmHWM:") {
-            status[VmHWMkB] = value;
-        } else if (name == "VmRSS:") {
-            status[VmRSSkB] = value;
-        } else if (name == "VmSwap:") {
-            status[VmSwapkB] = value;
-        }
+    if (unlikely(!ProcParser::parseSchedStat(buf, len, status))) {
+        return; // we just read some crap
     }
 
     hasRead = true;
+    readFiles |= 1u << FileSchedStat;
 }
 
-void ProcReader::readProcessIO() {
-    assert(status.size() == StatusColumnCount);
+bool ProcReader::isKernelThread() const {
+    if (status.isValid(PGRP)) {
+        return status.values[PGRP].i == 0;
+    }
+    return (status.isValid(PID)  && status.values[PID].i  == kthreaddPID) ||
+           (status.isValid(PPID) && status.values[PPID].i == kthreaddPID);
+}
 
-    if (!canReadIO)
-        return;
+/// returns the file @p column is read from or calculated with, FileKindCount if it is set otherwise
+static ProcFileKind fileOfColumn(const int column) {
+    switch (column) {
+        case VmPeakkB:
+        case VmSizekB:
+        case VmLckkB:
+        case VmHWMkB:
+        case VmRSSkB:
+        case VmSwapkB:
+            return FileStatus;
+        case TotReadBytes:
+        case CurReadBytes:
+        case TotReadBytesStorage:
+        case CurReadBytesStorage:
+        case TotWrittenBytes:
+        case CurWrittenBytes:
+        case TotWrittenBytesStorage:
+        case CurWrittenBytesStorage:
+        case TotReadCalls:
+        case CurReadCalls:
+        case TotWriteCalls:
+        case CurWriteCalls:
+            return FileIO;
+        case CPUTimeNs:
+        case RunQueueWaitNs:
+        case Timeslices:
+        case CurRunQueueWaitPerc:
+            return FileSchedStat;
+        case Processes:
+        case IntervalSecs:
+            return FileKindCount;
+        default:
+            return FileStat; // also taskstats, which is queried together with /proc/pid/stat
+    }
+}
+
+void ProcReader::carryOver(const ProcessStatus& previous, const bool* due) {
+    assert(cache.isEmpty);
 
-    const std::string fileName = "/proc/" + pid + "/io";
-    std::ifstream file(fileName.c_str(), std::ifstream::in);
-    if (unlikely(!file.good())) {
-        canReadIO = false;  // process may already have been terminated
+    uint64_t missing = previous.valid & ~status.valid;
+    if (likely(missing == 0)) {
         return;
     }
 
-    std::string line;
-    while (std::getline(file, line)) {
-        if (unlikely(line.empty()))
-            continue; // happens sometimes when self-profiling for some mysterious reason
-
-        std::stringstream sstr(line);
-        assert(sstr);
-        std::string name, value;
-        sstr >> name >> value;
-        if (!sstr) {
-            continue; // we just read some crap
+    for (int column = 0; column < StatusColumnCount; ++column) {
+        if (!(missing & ((uint64_t)1 << column))) continue;
+        const ProcFileKind kind = fileOfColumn(column);
+        if (kind == FileKindCount || due[kind]) {
+            missing &= ~((uint64_t)1 << column);
+            continue;
         }
-        assert(!name.empty());
-        assert(!value.empty());
-
-        if        (name == "rchar:") {
-            status[TotReadBytes] = value;
-        } else if (name == "wchar:") {
-            status[TotWrittenBytes] = value;
-        } else if (name == "read_bytes:") {
-            status[TotReadBytesStorage] = value;
-        } else if (name == "write_bytes:") {
-            status[TotWrittenBytesStorage] = value;
-        } else if (name == "syscr:") {
-            status[TotReadCalls] = value;
-        } else if (name == "syscw:") {
-            status[TotWriteCalls] = value;
+        if (column == Name) {
+            memcpy(status.name, previous.name, sizeof(status.name));
+        } else {
+            status.values[column] = previous.values[column];
         }
     }
-
-    hasRead = true;
+    status.valid |= missing;
 }
 
 void ProcReader::updateCache() {
@@ -175,7 +302,7 @@ void ProcReader::updateCache() {
     cache = Cache(status);
 }
 
-void ProcReader::calcAll(const Cache& oldCache, const double elapsedSecs) {
+void ProcReader::calcAll(const Cache& oldCache, const double* elapsedSecs, const double uptimeSecs) {
     if (unlikely(cache.isEmpty)) {
         assert(false);
         return;
@@ -185,19 +312,34 @@ void ProcReader::calcAll(const Cache& oldCache, const double elapsedSecs) {
         return; // process may already have been terminated
     }
 
-    calcRuntime();
-    calcUserSystemTimes();
-    calcCPUUtilization(oldCache, elapsedSecs);
-    calcIOUtilization(oldCache, elapsedSecs);
+    if (plan.calcRuntime)
+        calcRuntime(uptimeSecs);
+    if (plan.calcUserSystemTimes && hasReadFile(FileStat))
+        calcUserSystemTimes();
+    if (plan.calcCPUUtilization) {
+        const ProcFileKind source = cpuFromSchedStat() ? FileSchedStat : FileStat;
+        if (hasReadFile(source))
+            calcCPUUtilization(oldCache, elapsedSecs[source]);
+    }
+    if (plan.calcIOUtilization && hasReadFile(FileIO))
+        calcIOUtilization(oldCache, elapsedSecs[FileIO]);
+    if (plan.calcRunQueueWait && hasReadFile(FileSchedStat))
+        calcRunQueueWait(oldCache, elapsedSecs[FileSchedStat]);
 }
 
-void ProcReader::calcRuntime() {
+void ProcReader::calcRuntime(const double uptimeSecs) {
     if (unlikely(cache.isEmpty)) {
         assert(false);
         return;
     }
 
-    const double systemRuntimeSecs = uptime();
+    // runtime may already be provided by taskstats
+    if (status.isValid(RunTimeSecs)) {
+        cache.runTimeSecs = status.values[RunTimeSecs].d;
+        return;
+    }
+
+    const double systemRuntimeSecs = uptimeSecs;
     const double processStarttimeSecs = cache.startTimeJiffies / (double)getHertz();
 
     if (unlikely(systemRuntimeSecs - processStarttimeSecs <= 0)) {
@@ -205,7 +347,7 @@ void ProcReader::calcRuntime() {
     } else {
         cache.runTimeSecs = systemRuntimeSecs - processStarttimeSecs;
     }
-    status[RunTimeSecs] = numberToString(cache.runTimeSecs); // required for output
+    status.setReal(RunTimeSecs, cache.runTimeSecs);
 }
 
 void ProcReader::calcUserSystemTimes() {
@@ -216,8 +358,8 @@ void ProcReader::calcUserSystemTimes() {
 
     const int totProcessCPUTimeJiffies = cache.userTimeJiffies + cache.systemTimeJiffies;
 
-    status[UserTimePerc]   = numberToString(cache.userTimeJiffies   * 100.0 / (double)totProcessCPUTimeJiffies);
-    status[SystemTimePerc] = numberToString(cache.systemTimeJiffies * 100.0 / (double)totProcessCPUTimeJiffies);
+    status.setReal(UserTimePerc,   cache.userTimeJiffies   * 100.0 / (double)totProcessCPUTimeJiffies);
+    status.setReal(SystemTimePerc, cache.systemTimeJiffies * 100.0 / (double)totProcessCPUTimeJiffies);
 }
 
 void ProcReader::calcCPUUtilization(const Cache& oldCache, const double elapsedSecs) {
@@ -230,17 +372,26 @@ void ProcReader::calcCPUUtilization(const Cache& oldCache, const double elapsedS
         return;
     }
 
-    const double totProcessCPUTimeSecs = (cache.userTimeJiffies + cache.systemTimeJiffies) / (double)getHertz();
-    status[AvgCPUPerc] = numberToString((totProcessCPUTimeSecs * 100.0) / cache.runTimeSecs);
+    const bool nsecs = cpuFromSchedStat();
+    const double totProcessCPUTimeSecs = nsecs ? cache.cpuTimeNs / 1e9
+                                               : (cache.userTimeJiffies + cache.systemTimeJiffies) / (double)getHertz();
+    status.setReal(AvgCPUPerc, (totProcessCPUTimeSecs * 100.0) / cache.runTimeSecs);
 
-    if (oldCache.isEmpty) { // first iteration, cannot calculate current CPU
+    if (oldCache.isEmpty || elapsedSecs == 0) { // first iteration, cannot calculate current CPU
         return;
     }
 
-    const double oldTotProcessCPUTimeSecs = (oldCache.userTimeJiffies + oldCache.systemTimeJiffies) / (double)getHertz();
+    const double oldTotProcessCPUTimeSecs = nsecs ? oldCache.cpuTimeNs / 1e9
+                                                  : (oldCache.userTimeJiffies + oldCache.systemTimeJiffies) / (double)getHertz();
     const double elapsedCPUTimeSecs = totProcessCPUTimeSecs - oldTotProcessCPUTimeSecs;
     assert(elapsedCPUTimeSecs >= 0);
-    status[CurCPUPerc] = numberToString((elapsedCPUTimeSecs * 100.0) / elapsedSecs);
+    status.setReal(CurCPUPerc, (elapsedCPUTimeSecs * 100.0) / elapsedSecs);
+}
+
+bool ProcReader::cpuFromSchedStat() const {
+    // schedstat of a process only covers its main thread
+    return plan.schedStatCPU && status.isValid(CPUTimeNs) &&
+           (files.thread || (status.isValid(Threads) && status.values[Threads].i == 1));
 }
 
 void ProcReader::calcIOUtilization(const Cache& oldCache, const double elapsedSecs) {
@@ -253,23 +404,35 @@ void ProcReader::calcIOUtilization(const Cache& oldCache, const double elapsedSe
         return;
     }
 
-    if (oldCache.isEmpty) // first iteration, cannot calculate current IO
+    if (oldCache.isEmpty || elapsedSecs == 0) // first iteration, cannot calculate current IO
+        return;
+
+    status.setReal(CurReadBytes,           (cache.totReadBytes - oldCache.totReadBytes) / elapsedSecs);
+    status.setReal(CurWrittenBytes,        (cache.totWrittenBytes - oldCache.totWrittenBytes) / elapsedSecs);
+    status.setReal(CurReadBytesStorage,    (cache.totReadBytesStorage - oldCache.totReadBytesStorage) / elapsedSecs);
+    status.setReal(CurWrittenBytesStorage, (cache.totWrittenBytesStorage - oldCache.totWrittenBytesStorage) / elapsedSecs);
+    status.setReal(CurReadCalls,           (cache.totReadCalls - oldCache.totReadCalls) / elapsedSecs);
+    status.setReal(CurWriteCalls,          (cache.totWriteCalls - oldCache.totWriteCalls) / elapsedSecs);
+}
+
+void ProcReader::calcRunQueueWait(const Cache& oldCache, const double elapsedSecs) {
+    if (cache.isEmpty) {
+        assert(false);
+        return;
+    }
+
+    if (oldCache.isEmpty || elapsedSecs == 0) // first iteration, cannot calculate current wait
         return;
 
-    status[CurReadBytes]           = numberToString((cache.totReadBytes - oldCache.totReadBytes) / elapsedSecs);
-    status[CurWrittenBytes]        = numberToString((cache.totWrittenBytes - oldCache.totWrittenBytes) / elapsedSecs);
-    status[CurReadBytesStorage]    = numberToString((cache.totReadBytesStorage - oldCache.totReadBytesStorage) / elapsedSecs);
-    status[CurWrittenBytesStorage] = numberToString((cache.totWrittenBytesStorage - oldCache.totWrittenBytesStorage) / elapsedSecs);
-    status[CurReadCalls]           = numberToString((cache.totReadCalls - oldCache.totReadCalls) / elapsedSecs);
-    status[CurWriteCalls]          = numberToString((cache.totWriteCalls - oldCache.totWriteCalls) / elapsedSecs);
+    status.setReal(CurRunQueueWaitPerc, (cache.runQueueWaitNs - oldCache.runQueueWaitNs) / 1e9 * 100.0 / elapsedSecs);
 }
 
 PIDSet ProcReader::pids() {
     PIDSet pidSet;
 
-    DIR* dir = opendir("/proc");
+    DIR* dir = opendir(procRoot().c_str());
     if (unlikely(!dir)) {
-        std::cerr << "could not open /proc:" << strerror(errno) << std::endl;
+        std::cerr << "could not open " << procRoot() << ":" << strerror(errno) << std::endl;
         assert(false);
         return pidSet;
     }
@@ -286,3 +449,24 @@ PIDSet ProcReader::pids() {
     closedir(dir);
     return pidSet;
 }
+
+PIDSet ProcReader::tids(const std::string& pid) {
+    PIDSet tidSet;
+
+    // the process may have been terminated in the meantime
+    const std::string path = procRoot() + "/" + pid + "/task";
+    DIR* dir = opendir(path.c_str());
+    if (unlikely(!dir)) {
+        return tidSet;
+    }
+
+    struct dirent* entry;
+    while ((entry = readdir(dir))) {
+        if (std::isdigit(entry->d_name[0])) {
+            tidSet.insert(entry->d_name);
+        }
+    }
+
+    closedir(dir);
+    return tidSet;
+}
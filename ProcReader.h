@@ -2,10 +2,11 @@
 #define PROC_READER_H PROC_READER_H
 
 #include "ProcCache.h"
+#include "ProcFile.h"
 
 #include <set>
 #include <string>
-#include <vector>
+#include <cstdint>
 
 typedef enum {
     Name,                   ///< executable file name
@@ -44,6 +45,17 @@ typedef enum {
     CurReadCalls,           ///< current calls to read()/pread()
     TotWriteCalls,          ///< total calls to write()/pwrite()
     CurWriteCalls,          ///< current calls to write()/pwrite()
+    CPUDelayTotalNs,        ///< total time spent waiting for a CPU, in nanoseconds (requires taskstats)
+    BlkIODelayTotalNs,      ///< total time spent waiting for block I/O, in nanoseconds (requires taskstats)
+    SwapinDelayTotalNs,     ///< total time spent waiting for swapping in pages, in nanoseconds (requires taskstats)
+    TID,                    ///< thread ID, equals the PID for processes
+    LastCPU,                ///< CPU the process or thread last ran on
+    CPUTimeNs,              ///< total time spent on a CPU, in nanoseconds (main thread only for processes)
+    RunQueueWaitNs,         ///< total time spent waiting on a run queue, in nanoseconds (main thread only for processes)
+    Timeslices,             ///< number of timeslices run on a CPU (main thread only for processes)
+    CurRunQueueWaitPerc,    ///< current time spent waiting on a run queue since last iteration, in percent
+    Processes,              ///< number of processes aggregated into a row of a process tree, unset for single processes
+    IntervalSecs,           ///< time since the process has been read before, in seconds
     StatusColumnCount
 } StatusColumns;
 
@@ -54,24 +66,120 @@ const std::string statusColumnHeader[] = {
     "VmPeakkB", "VmSizekB", "VmLckkB", "VmHWMkB", "VmRsskB", "VmSwapkB",
     "TotReadBytes", "CurReadBytesPerSec", "TotReadBytesStorage", "CurReadBytesStoragePerSec",
     "TotWrittenBytes", "CurWrittenBytesPerSec", "TotWrittenBytesStorage", "CurWrittenBytesStoragePerSec",
-    "TotReadCalls", "CurReadCalls", "TotWriteCalls", "CurWriteCalls"
+    "TotReadCalls", "CurReadCalls", "TotWriteCalls", "CurWriteCalls",
+    "CPUDelayTotalNs", "BlkIODelayTotalNs", "SwapinDelayTotalNs",
+    "TID", "LastCPU", "CPUTimeNs", "RunQueueWaitNs", "Timeslices", "CurRunQueueWaitPerc",
+    "Processes", "IntervalSecs"
+};
+
+/// types of the status columns
+typedef enum {
+    ColumnText,    ///< text, only used for @ref Name
+    ColumnChar,    ///< single character, stored as integer
+    ColumnInteger, ///< signed integer
+    ColumnCounter, ///< unsigned integer, usually a monotonically increasing counter
+    ColumnReal     ///< floating point value, calculated by us
+} ColumnType;
+
+const ColumnType statusColumnType[] = {
+    ColumnText, ColumnChar, ColumnInteger, ColumnInteger, ColumnInteger, ColumnReal, ColumnReal, ColumnCounter, ColumnCounter,
+    ColumnCounter, ColumnCounter, ColumnReal, ColumnReal,
+    ColumnInteger, ColumnInteger, ColumnInteger, ColumnCounter, ColumnReal,
+    ColumnCounter, ColumnCounter, ColumnCounter, ColumnCounter, ColumnCounter, ColumnCounter,
+    ColumnCounter, ColumnReal, ColumnCounter, ColumnReal,
+    ColumnCounter, ColumnReal, ColumnCounter, ColumnReal,
+    ColumnCounter, ColumnReal, ColumnCounter, ColumnReal,
+    ColumnCounter, ColumnCounter, ColumnCounter,
+    ColumnInteger, ColumnInteger, ColumnCounter, ColumnCounter, ColumnCounter, ColumnReal,
+    ColumnInteger, ColumnReal
+};
+
+/// value of a single status column, which member is used depends on @ref statusColumnType
+union StatusValue {
+    int64_t  i; ///< @ref ColumnChar and @ref ColumnInteger
+    uint64_t u; ///< @ref ColumnCounter
+    double   d; ///< @ref ColumnReal
+};
+
+/// maximum length of the executable name including the terminating NUL,
+/// kernel threads may have names longer than TASK_COMM_LEN
+const size_t maxNameLength = 64;
+
+/// stores all relevant data from /proc/pid/ as typed values,
+/// text is only produced when printing them
+/// @note value initialization (ProcessStatus()) leaves all columns unset
+struct ProcessStatus {
+    uint64_t    valid;                     ///< bitmask of columns holding a value
+    char        name[maxNameLength];       ///< value of the @ref Name column
+    StatusValue values[StatusColumnCount]; ///< values of all other columns
+
+    /// returns whether the given column holds a value
+    bool isValid(const int column) const { return (valid & ((uint64_t)1 << column)) != 0; }
+    /// marks the given column as holding a value
+    void setValid(const int column) { valid |= (uint64_t)1 << column; }
+
+    /// sets a @ref ColumnChar or @ref ColumnInteger column
+    void setInteger(const int column, const int64_t value) { values[column].i = value; setValid(column); }
+    /// sets a @ref ColumnCounter column
+    void setCounter(const int column, const uint64_t value) { values[column].u = value; setValid(column); }
+    /// sets a @ref ColumnReal column
+    void setReal(const int column, const double value) { values[column].d = value; setValid(column); }
 };
 
-/// stores all relevant data from /proc/pid/
-typedef std::vector<std::string> ProcessStatus;
 /// stores all current PIDs from /proc/
 typedef std::set<std::string> PIDSet;
 
+class TaskStatsReader;
+
+/// files to read and values to calculate, derived from the columns to show
+/// @note /proc/pid/stat is always read unless taskstats provides all required columns,
+///       it is cheap and required for detecting kernel threads
+class ReadPlan {
+  public:
+    /// creates a plan reading and calculating everything from /proc except /proc/pid/schedstat
+    ReadPlan();
+
+    /// creates a plan for the given status columns, reading and calculating everything if empty,
+    /// /proc/pid/schedstat only if one of its columns is given or @p schedStat is set,
+    /// columns provided by @p taskStatsReader are not read from /proc, pass NULL to read everything from /proc,
+    /// @p schedStat calculates CPU usage from /proc/pid/schedstat instead of jiffies where possible
+    ReadPlan(const std::set<int>& fields, TaskStatsReader* taskStatsReader, const bool schedStat);
+
+    TaskStatsReader* taskStats; ///< taskstats backend, NULL if not used
+
+    bool readStat;            ///< read /proc/pid/stat?
+    bool readStatus;          ///< read /proc/pid/status?
+    bool readIO;              ///< read /proc/pid/io?
+    bool readSchedStat;       ///< read /proc/pid/schedstat?
+    bool schedStatCPU;        ///< calculate CPU usage from /proc/pid/schedstat?
+    bool calcRuntime;         ///< call @ref ProcReader::calcRuntime()?
+    bool calcUserSystemTimes; ///< call @ref ProcReader::calcUserSystemTimes()?
+    bool calcCPUUtilization;  ///< call @ref ProcReader::calcCPUUtilization()?
+    bool calcIOUtilization;   ///< call @ref ProcReader::calcIOUtilization()?
+    bool calcRunQueueWait;    ///< call @ref ProcReader::calcRunQueueWait()?
+
+    /// returns a copy of this plan which only reads the files marked in @p due, indexed by @ref ProcFileKind,
+    /// taskstats is queried together with /proc/pid/stat
+    ReadPlan restrictTo(const bool* due) const;
+
+    /// returns whether anything is read at all
+    bool readsAny() const { return readStat || readStatus || readIO || readSchedStat || taskStats; }
+};
+
 /// reads and processes various data from /proc/pid/
 class ProcReader {
   public:
-    /// constructs a ProcReader object for the given PID
-    ProcReader(const std::string& processID);
+    /// constructs a ProcReader object reading from the given files,
+    /// files are read into @p readBuffer, @p readPlan determines what to read and calculate
+    ProcReader(ProcFiles& procFiles, ReadBuffer& readBuffer, const ReadPlan& readPlan);
 
-    /// reads all interesting information from /proc,
-    /// combines @ref readProcessStat(), @ref readProcessStatus() and @ref readProcessIO()
+    /// reads all information required by the read plan, combines @ref readTaskStats(),
+    /// @ref readProcessStat(), @ref readProcessStatus(), @ref readProcessIO() and @ref readProcessSchedStat()
     void readAll();
 
+    /// reads various information via taskstats
+    void readTaskStats();
+
     /// parses various information from /proc/pid/stat
     void readProcessStat();
 
@@ -83,30 +191,68 @@ class ProcReader {
     /// parses IO information from /proc/pid/io
     void readProcessIO();
 
+    /// parses scheduler statistics from /proc/pid/schedstat
+    void readProcessSchedStat();
+
+    /// parses the contents of /proc/pid/stat which have been read elsewhere, e.g. in a batch,
+    /// @p len is the number of bytes read or -1 if reading has failed
+    void parseProcessStat(const char* buf, const ssize_t len);
+
+    /// parses the contents of /proc/pid/status which have been read elsewhere, see @ref parseProcessStat()
+    void parseProcessStatus(const char* buf, const ssize_t len);
+
+    /// parses the contents of /proc/pid/io which have been read elsewhere, see @ref parseProcessStat()
+    void parseProcessIO(const char* buf, const ssize_t len);
+
+    /// parses the contents of /proc/pid/schedstat which have been read elsewhere, see @ref parseProcessStat()
+    void parseProcessSchedStat(const char* buf, const ssize_t len);
+
     /// updates data cache, has to be called before any of the calc functions
     /// @note don't call multiple times
     void updateCache();
 
-    /// processes all read information,
+    /// takes the columns of the files which were not due in this iteration from @p previous,
+    /// @p due is indexed by @ref ProcFileKind, files which were due but could not be read are not carried over,
+    /// has to be called before @ref updateCache()
+    void carryOver(const ProcessStatus& previous, const bool* due);
+
+    /// processes all read information as required by the read plan,
     /// combines @ref calcRuntime(), @ref calcUserSystemTimes(),
-    /// @ref calcCPUUtilization() and @ref calcIOUtilization()
-    void calcAll(const Cache& oldCache, const double elapsedSecs);
+    /// @ref calcCPUUtilization(), @ref calcIOUtilization() and @ref calcRunQueueWait(),
+    /// current values are only calculated from files read in this iteration
+    /// @param elapsedSecs time since each file has been read before, indexed by @ref ProcFileKind, 0 if never
+    /// @param uptimeSecs system uptime in seconds, see @ref calcRuntime()
+    void calcAll(const Cache& oldCache, const double* elapsedSecs, const double uptimeSecs);
 
-    /// calculates total process runtime in seconds
+    /// calculates total process runtime in seconds from the system uptime @p uptimeSecs
     /// and fills @ref runTimeSecs in @p cache
-    void calcRuntime();
+    void calcRuntime(const double uptimeSecs);
 
     /// calculates user and system times in percent
     void calcUserSystemTimes();
 
-    /// calculates average and current CPU usage
+    /// calculates average and current CPU usage, from nanoseconds if @ref cpuFromSchedStat()
     void calcCPUUtilization(const Cache& oldCache, const double elapsedSecs);
 
+    /// returns whether CPU usage is calculated from /proc/pid/schedstat, i.e. the plan says so and
+    /// it covers all CPU time, which is the case for threads and single-threaded processes
+    bool cpuFromSchedStat() const;
+
     /// calculates current IO load
     void calcIOUtilization(const Cache& oldCache, const double elapsedSecs);
 
+    /// calculates the current time spent waiting on a run queue
+    void calcRunQueueWait(const Cache& oldCache, const double elapsedSecs);
+
     /// returns whether this process is a kernel thread
-    bool isKernelThread() const { return status[PGRP] == "0"; }
+    /// @note without /proc/pid/stat we assume kernel threads to be kthreadd and its children
+    bool isKernelThread() const;
+
+    /// returns whether we have read any data at all, false if the process has been terminated
+    bool hasReadAny() const { return hasRead; }
+
+    /// returns whether the given file has been read, taskstats counts as /proc/pid/stat
+    bool hasReadFile(const ProcFileKind kind) const { return (readFiles & (1u << kind)) != 0; }
 
     /// returns data we have read and processed
     const ProcessStatus& getProcessStatus() const { return status; }
@@ -117,15 +263,17 @@ class ProcReader {
     /// returns a set of all current PIDs
     static PIDSet pids();
 
+    /// returns a set of the IDs of all current threads of the given process, empty if it has been terminated
+    static PIDSet tids(const std::string& pid);
+
   private:
-    std::string    pid;     ///< PID to read, stored as string for performance reasons (requires no conversions)
+    ProcFiles&     files;   ///< files to read from, kept open across iterations
+    ReadBuffer&    buffer;  ///< buffer to read files into
+    const ReadPlan& plan;   ///< what to read and calculate
     bool           hasRead; ///< stores if we have read any data from /proc at all
+    unsigned int   readFiles; ///< bitmask of the files read, see @ref hasReadFile()
     ProcessStatus  status;  ///< data we have read and processed
     Cache          cache;   ///< cache for read data
-
-    bool           canReadStat;    ///< can we read /proc/pid/stat?
-    bool           canReadStatus;  ///< can we read /proc/pid/status?
-    bool           canReadIO;      ///< can we read /proc/pid/io?
 };
 
 #endif // PROC_READER_H
@@ -0,0 +1,218 @@
+#include "ProcessTrees.h"
+#include "ProcParser.h"
+
+#include <cstring>
+
+/// how a column is aggregated over the processes of a tree
+enum Aggregation {
+    AggregateNone,    ///< not meaningful for a tree, e.g. averages and peaks, left unset
+    AggregateRoot,    ///< taken from the root process, e.g. its name
+    AggregateCurrent, ///< summed over the processes read in the current iteration, e.g. RSS and rates
+    AggregateTotal    ///< summed over all processes including terminated ones, e.g. CPU time
+};
+
+/// returns how @p column is aggregated
+static Aggregation aggregationOf(const int column) {
+    switch (column) {
+        case Name:
+        case State:
+        case PID:
+        case PPID:
+        case PGRP:
+        case Priority:
+        case Nice:
+        case StartTimeJiffies:
+        case RunTimeSecs:
+        case TID:
+        case IntervalSecs:
+            return AggregateRoot;
+        case CurCPUPerc:
+        case Threads:
+        case VmSizekB:
+        case VmLckkB:
+        case VmRSSkB:
+        case VmSwapkB:
+        case CurReadBytes:
+        case CurReadBytesStorage:
+        case CurWrittenBytes:
+        case CurWrittenBytesStorage:
+        case CurReadCalls:
+        case CurWriteCalls:
+        case CurRunQueueWaitPerc:
+            return AggregateCurrent;
+        case MinFlt:
+        case MajFlt:
+        case UserTimeJiffies:
+        case SystemTimeJiffies:
+        case TotReadBytes:
+        case TotReadBytesStorage:
+        case TotWrittenBytes:
+        case TotWrittenBytesStorage:
+        case TotReadCalls:
+        case TotWriteCalls:
+        case CPUDelayTotalNs:
+        case BlkIODelayTotalNs:
+        case SwapinDelayTotalNs:
+        case CPUTimeNs:
+        case RunQueueWaitNs:
+        case Timeslices:
+            return AggregateTotal;
+        default:
+            return AggregateNone;
+    }
+}
+
+/// adds @p column of @p from to @p to if it holds a value
+static void addColumn(ProcessStatus& to, const ProcessStatus& from, const int column) {
+    if (!from.isValid(column)) return;
+
+    const bool first = !to.isValid(column);
+    switch (statusColumnType[column]) {
+        case ColumnCounter:
+            to.setCounter(column, (first ? 0 : to.values[column].u) + from.values[column].u);
+            break;
+        case ColumnInteger:
+            to.setInteger(column, (first ? 0 : to.values[column].i) + from.values[column].i);
+            break;
+        case ColumnReal:
+            to.setReal(column, (first ? 0.0 : to.values[column].d) + from.values[column].d);
+            break;
+        default:
+            break;
+    }
+}
+
+ProcessTrees::ProcessTrees() : trees(), members(), outsiders(), buffer() {
+}
+
+void ProcessTrees::addRoot(const int pid) {
+    trees.insert(std::make_pair(pid, Tree()));
+    members[pid] = pid;
+    outsiders.erase(pid);
+}
+
+bool ProcessTrees::addChild(const int pid, const int ppid) {
+    const std::map<int, int>::const_iterator parentIt = members.find(ppid);
+    if (parentIt == members.end()) return false;
+
+    members[pid] = parentIt->second;
+    outsiders.erase(pid);
+    return true;
+}
+
+void ProcessTrees::scan(const PIDSet& pids, std::vector<std::string>& added) {
+    // parents of the processes not seen before
+    std::map<int, int> parents;
+    std::set<int> current;
+    for (PIDSet::const_iterator pidIt = pids.begin(); pidIt != pids.end(); ++pidIt) {
+        const int pid = atoi(pidIt->c_str());
+        current.insert(pid);
+        if (members.count(pid) == 0 && outsiders.count(pid) == 0) {
+            parents[pid] = readParent(pid);
+        }
+    }
+
+    // forget terminated outsiders, their PIDs may be reused by processes of a tree
+    for (std::set<int>::iterator outsiderIt = outsiders.begin(); outsiderIt != outsiders.end(); ) {
+        if (current.count(*outsiderIt) == 0) {
+            outsiders.erase(outsiderIt++);
+        } else {
+            ++outsiderIt;
+        }
+    }
+
+    // children may be listed before their parents once PIDs have wrapped around
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (std::map<int, int>::iterator parentIt = parents.begin(); parentIt != parents.end(); ) {
+            if (addChild(parentIt->first, parentIt->second)) {
+                added.push_back(numberToString(parentIt->first));
+                parents.erase(parentIt++);
+                changed = true;
+            } else {
+                ++parentIt;
+            }
+        }
+    }
+
+    for (std::map<int, int>::const_iterator parentIt = parents.begin(); parentIt != parents.end(); ++parentIt) {
+        outsiders.insert(parentIt->first);
+    }
+}
+
+void ProcessTrees::remove(const int pid, const ProcessStatus& lastStatus) {
+    outsiders.erase(pid);
+
+    const std::map<int, int>::iterator memberIt = members.find(pid);
+    if (memberIt == members.end()) return;
+
+    Tree& tree = trees[memberIt->second];
+    for (int column = 0; column < StatusColumnCount; ++column) {
+        if (aggregationOf(column) == AggregateTotal) {
+            addColumn(tree.exited, lastStatus, column);
+        }
+    }
+    members.erase(memberIt);
+}
+
+void ProcessTrees::add(const int pid, const TimeSpec& ts, const ProcessStatus& status) {
+    const std::map<int, int>::const_iterator memberIt = members.find(pid);
+    if (memberIt == members.end()) return;
+
+    Tree& tree = trees[memberIt->second];
+    if (pid == memberIt->second) {
+        tree.root = status;
+    }
+    for (int column = 0; column < StatusColumnCount; ++column) {
+        const Aggregation aggregation = aggregationOf(column);
+        if (aggregation == AggregateCurrent || aggregation == AggregateTotal) {
+            addColumn(tree.sum, status, column);
+        }
+    }
+    if (tree.processes == 0 || ts > tree.ts) {
+        tree.ts = ts;
+    }
+    ++tree.processes;
+}
+
+void ProcessTrees::writeRows(Output& output) {
+    for (TreeMap::iterator treeIt = trees.begin(); treeIt != trees.end(); ++treeIt) {
+        Tree& tree = treeIt->second;
+        if (tree.processes == 0) continue;
+
+        ProcessStatus& status = tree.sum;
+        for (int column = 0; column < StatusColumnCount; ++column) {
+            switch (aggregationOf(column)) {
+                case AggregateRoot:
+                    if (tree.root.isValid(column)) {
+                        status.values[column] = tree.root.values[column];
+                        status.setValid(column);
+                    }
+                    break;
+                case AggregateTotal:
+                    addColumn(status, tree.exited, column);
+                    break;
+                default:
+                    break;
+            }
+        }
+        memcpy(status.name, tree.root.name, maxNameLength);
+        status.setInteger(Processes, tree.processes);
+
+        output.writeRow(tree.ts, status);
+
+        tree.sum = ProcessStatus();
+        tree.processes = 0;
+    }
+}
+
+int ProcessTrees::readParent(const int pid) {
+    ProcFile file(procRoot() + "/" + numberToString(pid) + "/stat");
+    ProcessStatus status = ProcessStatus();
+    const ssize_t len = file.read(buffer);
+    if (len <= 0 || !ProcParser::parseStat(&buffer[0], len, status) || !status.isValid(PPID)) {
+        return -1;
+    }
+    return status.values[PPID].i;
+}
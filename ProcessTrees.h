@@ -0,0 +1,72 @@
+#ifndef PROCESS_TREES_H
+#define PROCESS_TREES_H PROCESS_TREES_H
+
+#include "Output.h"
+#include "ProcFile.h"
+#include "ProcReader.h"
+#include "TimeSpec.h"
+
+#include <map>
+#include <set>
+#include <vector>
+
+/// process trees below given root processes, e.g. a build started with -e,
+/// the status of all processes of a tree is aggregated into a single row
+/// @note membership is decided once per process from its parent PID when it appears,
+///       either from a fork event or by reading its /proc/pid/stat once,
+///       processes stay in their tree if they are reparented after their parent has terminated
+class ProcessTrees {
+  public:
+    ProcessTrees();
+
+    /// starts a tree at @p pid
+    void addRoot(const int pid);
+
+    /// returns whether no tree is tracked
+    bool isEmpty() const { return trees.empty(); }
+
+    /// returns whether @p pid belongs to a tree
+    bool isMember(const int pid) const { return members.count(pid) != 0; }
+
+    /// adds @p pid to the tree of its parent @p ppid, if the parent belongs to one
+    /// @return whether @p pid has been added
+    bool addChild(const int pid, const int ppid);
+
+    /// checks which of the current @p pids have not been seen before and belong to a tree,
+    /// their parent PID is read only once, the PIDs added to a tree are appended to @p added
+    void scan(const PIDSet& pids, std::vector<std::string>& added);
+
+    /// removes a terminated process from its tree, the counters of its last status
+    /// still count for the tree, e.g. the CPU time and bytes read
+    void remove(const int pid, const ProcessStatus& lastStatus);
+
+    /// adds the status of a process read in the current iteration to its tree, ignores other processes
+    void add(const int pid, const TimeSpec& ts, const ProcessStatus& status);
+
+    /// writes one row per tree with processes read in the current iteration, in order of the root PIDs,
+    /// and starts aggregating the next iteration
+    void writeRows(Output& output);
+
+  private:
+    /// aggregated status of a single tree
+    struct Tree {
+        Tree() : root(), exited(), sum(), ts(), processes(0) {}
+
+        ProcessStatus root;      ///< last status of the root process, identifies the tree
+        ProcessStatus exited;    ///< summed counters of terminated processes
+        ProcessStatus sum;       ///< aggregated status of the current iteration
+        TimeSpec      ts;        ///< latest time a process has been read in the current iteration
+        int64_t       processes; ///< number of processes aggregated in the current iteration
+    };
+    typedef std::map<int, Tree> TreeMap;
+
+    /// returns the parent PID of @p pid read from /proc/pid/stat, -1 if it could not be read
+    int readParent(const int pid);
+
+    TreeMap            trees;     ///< all trees by PID of their root
+    std::map<int, int> members;   ///< PID of the root of each process belonging to a tree
+    std::set<int>      outsiders; ///< processes known not to belong to any tree
+    ReadBuffer         buffer;    ///< buffer to read /proc/pid/stat into
+};
+
+#endif // PROCESS_TREES_H
@@ -0,0 +1,214 @@
+#include "Recording.h"
+#include "helper.h"
+
+#include <algorithm>
+#include <cstring>
+
+/// appends the raw bytes of @p value
+template <class T>
+static void appendRaw(std::string& out, const T& value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+/// appends @p value as varint, 7 bits per byte starting with the lowest ones
+static void appendVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out += (char)(value | 0x80);
+        value >>= 7;
+    }
+    out += (char)value;
+}
+
+/// converts a timestamp to nanoseconds
+static uint64_t toNsecs(const TimeSpec& ts) {
+    return (uint64_t)ts.ts.tv_sec * TimeSpec::secInNsec + ts.ts.tv_nsec;
+}
+
+void Recording::appendHeader(std::string& out) {
+    out.append(magic, sizeof(magic));
+    appendRaw(out, version);
+    appendRaw(out, (uint32_t)getHertz());
+}
+
+void Recording::appendTick(std::string& out, const TimeSpec& ts, const double uptimeSecs) {
+    out += (char)RecordTick;
+    appendRaw(out, toNsecs(ts));
+    appendRaw(out, uptimeSecs);
+}
+
+void Recording::appendProcess(std::string& out, const int pid, const int tid, const TimeSpec& ts) {
+    out += (char)RecordProcess;
+    appendRaw(out, (int32_t)pid);
+    appendRaw(out, (int32_t)tid);
+    appendRaw(out, toNsecs(ts));
+}
+
+void Recording::appendFile(std::string& out, const ProcFileKind kind, const char* data, const ssize_t len, std::string& previous) {
+    if (len < 0) {
+        out += (char)RecordFileFailed;
+        out += (char)kind;
+        previous.clear();
+        return;
+    }
+
+    // most of a file usually stays the same between two reads, only store what differs
+    const size_t size = len;
+    const size_t maxShared = std::min(size, previous.size());
+    size_t prefix = 0;
+    while (prefix < maxShared && data[prefix] == previous[prefix]) {
+        ++prefix;
+    }
+    size_t suffix = 0;
+    while (suffix < maxShared - prefix && data[size - 1 - suffix] == previous[previous.size() - 1 - suffix]) {
+        ++suffix;
+    }
+
+    out += (char)RecordFile;
+    out += (char)kind;
+    appendVarint(out, prefix);
+    appendVarint(out, suffix);
+    appendVarint(out, size - prefix - suffix);
+    out.append(data + prefix, size - prefix - suffix);
+
+    previous.assign(data, size);
+}
+
+RecordingReader::RecordingReader(std::istream& inStream) :
+  in(inStream), hasHeader(false), failed(false), hertz(0), pid(0), tid(0), contents(), recorded(), middle() {
+}
+
+bool RecordingReader::next(Record& record) {
+    for (;;) {
+        const int type = in.get();
+        if (type == std::char_traits<char>::eof()) {
+            return false;
+        }
+
+        if (type == Recording::magic[0]) {
+            if (!readHeader()) return false;
+            continue;
+        }
+
+        if (!hasHeader) {
+            std::cerr << "not an audria recording" << std::endl;
+            failed = true;
+            return false;
+        }
+
+        record.type = (Recording::RecordType)type;
+        switch (type) {
+            case Recording::RecordTick: {
+                forgetUnrecorded();
+                uint64_t timeNs;
+                in.read(reinterpret_cast<char*>(&timeNs), sizeof(timeNs));
+                in.read(reinterpret_cast<char*>(&record.uptimeSecs), sizeof(record.uptimeSecs));
+                record.ts = TimeSpec(timeNs / TimeSpec::secInNsec, timeNs % TimeSpec::secInNsec);
+                break;
+            }
+            case Recording::RecordProcess: {
+                int32_t processID, threadID;
+                uint64_t timeNs;
+                in.read(reinterpret_cast<char*>(&processID), sizeof(processID));
+                in.read(reinterpret_cast<char*>(&threadID), sizeof(threadID));
+                in.read(reinterpret_cast<char*>(&timeNs), sizeof(timeNs));
+                pid = processID;
+                tid = threadID;
+                recorded.insert(std::make_pair(pid, tid));
+                record.pid = pid;
+                record.tid = tid;
+                record.ts = TimeSpec(timeNs / TimeSpec::secInNsec, timeNs % TimeSpec::secInNsec);
+                break;
+            }
+            case Recording::RecordFile:
+            case Recording::RecordFileFailed: {
+                const int kind = in.get();
+                if (kind < 0 || kind >= FileKindCount) {
+                    std::cerr << "invalid file record in recording" << std::endl;
+                    failed = true;
+                    return false;
+                }
+                record.pid  = pid;
+                record.tid  = tid;
+                record.kind = (ProcFileKind)kind;
+                record.content = NULL;
+                if (type == Recording::RecordFileFailed) {
+                    contents.erase(ContentKey(pid, tid, kind));
+                    break;
+                }
+                std::string& content = contents[ContentKey(pid, tid, kind)];
+
+                uint64_t prefix, suffix, length;
+                if (!readVarint(prefix) || !readVarint(suffix) || !readVarint(length) ||
+                    prefix + suffix > content.size()) {
+                    std::cerr << "invalid file record in recording" << std::endl;
+                    failed = true;
+                    return false;
+                }
+                middle.resize(length);
+                if (length > 0) in.read(&middle[0], length);
+
+                content.replace(prefix, content.size() - prefix - suffix, middle);
+                record.content = &content;
+                break;
+            }
+            default:
+                std::cerr << "invalid record type " << type << " in recording" << std::endl;
+                failed = true;
+                return false;
+        }
+
+        if (!in) {
+            std::cerr << "truncated record at end of recording" << std::endl;
+            failed = true;
+            return false;
+        }
+        return true;
+    }
+}
+
+void RecordingReader::forgetUnrecorded() {
+    for (ContentMap::iterator contentIt = contents.begin(); contentIt != contents.end(); ) {
+        if (recorded.count(std::make_pair(contentIt->first.pid, contentIt->first.tid)) == 0) {
+            contents.erase(contentIt++);
+        } else {
+            ++contentIt;
+        }
+    }
+    recorded.clear();
+}
+
+bool RecordingReader::readHeader() {
+    char magic[sizeof(Recording::magic)];
+    magic[0] = Recording::magic[0];
+    uint32_t headerVersion;
+    in.read(magic + 1, sizeof(magic) - 1);
+    in.read(reinterpret_cast<char*>(&headerVersion), sizeof(headerVersion));
+    in.read(reinterpret_cast<char*>(&hertz), sizeof(hertz));
+    if (!in || memcmp(magic, Recording::magic, sizeof(magic)) != 0) {
+        std::cerr << "not an audria recording or truncated header" << std::endl;
+        failed = true;
+        return false;
+    }
+    if (headerVersion != Recording::version) {
+        std::cerr << "unsupported recording version " << headerVersion << std::endl;
+        failed = true;
+        return false;
+    }
+
+    // contents of the previous recording are not referenced anymore
+    contents.clear();
+    recorded.clear();
+    hasHeader = true;
+    return true;
+}
+
+bool RecordingReader::readVarint(uint64_t& value) {
+    value = 0;
+    for (unsigned int shift = 0; shift < 64; shift += 7) {
+        const int byte = in.get();
+        if (byte == std::char_traits<char>::eof()) return false;
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
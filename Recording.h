@@ -0,0 +1,120 @@
+#ifndef RECORDING_H
+#define RECORDING_H RECORDING_H
+
+#include "ProcFile.h"
+#include "TimeSpec.h"
+
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <stdint.h>
+#include <sys/types.h>
+
+/// recording of the raw contents of files read from /proc, replayed later to calculate any fields
+/// - header: @ref magic, version and kernel clock ticks per second (all uint32_t, host byte order)
+/// - tick:   type, time in nanoseconds, system uptime in seconds (double)
+/// - process: type, PID, TID (0 for processes), time in nanoseconds, followed by the process' file records
+/// - file:   type, kind, then as varints: length of the prefix and suffix shared with the previous
+///           content of the same file of the same process, length of the differing part followed by it
+/// - failed file: type, kind, the file could not be read (process terminated), its previous content is forgotten
+/// @note only the difference to the previous content of a file is stored, so records must not be dropped
+/// @note each iteration holds every process, the previous contents of processes missing from an iteration
+///       are forgotten by the reader, the writer starts from scratch once such a process appears again
+/// @note appending to an existing file starts a new header, previous contents are forgotten there
+namespace Recording {
+    /// magic bytes at the start of each header
+    const char magic[8] = {'A', 'U', 'D', 'R', 'I', 'A', 'R', '\0'};
+
+    /// version of the recording format
+    const uint32_t version = 1;
+
+    /// type of a record, never equals the first magic byte
+    enum RecordType {
+        RecordTick = 1,
+        RecordProcess,
+        RecordFile,
+        RecordFileFailed
+    };
+
+    /// appends a header
+    void appendHeader(std::string& out);
+
+    /// appends the start of a tick
+    void appendTick(std::string& out, const TimeSpec& ts, const double uptimeSecs);
+
+    /// appends the start of a process read at @p ts, followed by its files,
+    /// @p tid is the ID of a single thread of the process or 0
+    void appendProcess(std::string& out, const int pid, const int tid, const TimeSpec& ts);
+
+    /// appends the content of a file, @p len is -1 if reading it failed, which clears @p previous,
+    /// stores only the difference to @p previous and updates it
+    void appendFile(std::string& out, const ProcFileKind kind, const char* data, const ssize_t len, std::string& previous);
+}
+
+/// reads a recording record by record
+class RecordingReader {
+  public:
+    /// a single record, which members are set depends on @ref type
+    struct Record {
+        Record() : type(Recording::RecordTick), ts(), uptimeSecs(0.0), pid(0), tid(0), kind(FileStat), content(NULL) {}
+
+        Recording::RecordType type;
+        TimeSpec              ts;         ///< tick and process
+        double                uptimeSecs; ///< tick
+        int                   pid;        ///< process and file, file records belong to the last process
+        int                   tid;        ///< process, 0 unless a single thread has been recorded
+        ProcFileKind   kind;       ///< file
+        const std::string*    content;    ///< file, NULL if the file could not be read
+    };
+
+    RecordingReader(std::istream& inStream);
+
+    /// reads the next record, headers are handled internally
+    /// @return false at the end of the recording or on errors, the latter are reported
+    bool next(Record& record);
+
+    /// returns the kernel clock ticks per second of the system the recording was made on
+    uint32_t getHertz() const { return hertz; }
+
+    /// returns whether reading stopped because of an error
+    bool hasFailed() const { return failed; }
+
+  private:
+    /// reads a header following the magic bytes
+    bool readHeader();
+
+    /// reads a varint
+    bool readVarint(uint64_t& value);
+
+    /// forgets the contents of all processes not recorded in the iteration which has just ended
+    void forgetUnrecorded();
+
+    /// identifies a file by PID, TID and kind
+    struct ContentKey {
+        ContentKey(const int processID, const int threadID, const int fileKind) :
+          pid(processID), tid(threadID), kind(fileKind) {}
+        bool operator<(const ContentKey& other) const {
+            if (pid != other.pid) return pid < other.pid;
+            if (tid != other.tid) return tid < other.tid;
+            return kind < other.kind;
+        }
+
+        int pid;
+        int tid;
+        int kind;
+    };
+    typedef std::map<ContentKey, std::string> ContentMap;
+
+    std::istream& in;       ///< stream to read from
+    bool          hasHeader;///< a header has been read
+    bool          failed;   ///< an error occurred
+    uint32_t      hertz;    ///< clock ticks per second from the last header
+    int           pid;      ///< PID of the last process record
+    int           tid;      ///< TID of the last process record
+    ContentMap    contents; ///< last content of each file
+    std::set<std::pair<int, int> > recorded; ///< PID and TID of the processes recorded in the current iteration
+    std::string   middle;   ///< buffer for the differing part of a file
+};
+
+#endif // RECORDING_H
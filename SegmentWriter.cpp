@@ -0,0 +1,188 @@
+#include "SegmentWriter.h"
+#include "helper.h"
+
+#include <algorithm>
+#include <iostream>
+#include <climits>
+#include <cassert>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/// minimum amount a segment grows by if a tick's output doesn't fit
+static const size_t minGrowBytes = 64 * 1024;
+
+SegmentWriter::SegmentWriter(const std::string& baseName, const SegmentPolicy& segmentPolicy) :
+  std::streambuf(), name(baseName), policy(segmentPolicy), segments(), next(0), fd(-1), base(NULL), mappedSize(0),
+  startTS(), failed(false), discarded() {
+    assert(policy.segmentBytes > 0);
+}
+
+SegmentWriter::~SegmentWriter() {
+    finishSegment();
+}
+
+bool SegmentWriter::open() {
+    const size_t sep = name.rfind('/');
+    const std::string dirName = sep == std::string::npos ? "." : sep == 0 ? "/" : name.substr(0, sep);
+    const std::string prefix  = (sep == std::string::npos ? name : name.substr(sep + 1)) + ".";
+
+    DIR* dir = opendir(dirName.c_str());
+    if (!dir) {
+        std::cerr << "could not open directory '" << dirName << "': " << strerror(errno) << std::endl;
+        return false;
+    }
+    std::vector<unsigned long> numbers;
+    struct dirent* entry;
+    while ((entry = readdir(dir))) {
+        const std::string fileName(entry->d_name);
+        if (fileName.compare(0, prefix.size(), prefix) != 0) continue;
+
+        const std::string number = fileName.substr(prefix.size());
+        if (number.empty() || number.find_first_not_of("0123456789") != std::string::npos ||
+            (number[0] == '0' && number.size() > 1)) continue;
+        numbers.push_back(strtoul(number.c_str(), NULL, 10));
+    }
+    closedir(dir);
+
+    std::sort(numbers.begin(), numbers.end());
+    segments.assign(numbers.begin(), numbers.end());
+    next = numbers.empty() ? 0 : numbers.back() + 1;
+
+    return startSegment();
+}
+
+bool SegmentWriter::rotationDue(const TimeSpec& nowTS) const {
+    if (fd == -1) return false;
+
+    const size_t used = pptr() - pbase();
+    return used >= policy.segmentBytes || (policy.maxAgeSecs > 0.0 && (nowTS - startTS).seconds() >= policy.maxAgeSecs);
+}
+
+bool SegmentWriter::rotate() {
+    if (failed) return false;
+
+    finishSegment();
+    return startSegment();
+}
+
+SegmentWriter::int_type SegmentWriter::overflow(int_type c) {
+    if (!failed) {
+        const size_t used = pptr() - pbase();
+        const size_t size = mappedSize + std::max(policy.segmentBytes / 8, minGrowBytes);
+        void* mem = MAP_FAILED;
+        if (reserve(size)) {
+            mem = mremap(base, mappedSize, size, MREMAP_MAYMOVE);
+        }
+        if (mem != MAP_FAILED) {
+            base       = static_cast<char*>(mem);
+            mappedSize = size;
+            setPutArea(used);
+        } else {
+            std::cerr << "could not grow output segment, discarding further output: " << strerror(errno) << std::endl;
+            fail();
+        }
+    } else {
+        setp(&discarded[0], &discarded[0] + discarded.size());
+    }
+
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+    return traits_type::not_eof(c);
+}
+
+int SegmentWriter::sync() {
+    return 0;
+}
+
+std::string SegmentWriter::segmentName(const unsigned long number) const {
+    return name + "." + numberToString(number);
+}
+
+bool SegmentWriter::startSegment() {
+    assert(fd == -1);
+
+    const std::string fileName = segmentName(next);
+    fd = ::open(fileName.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd == -1) {
+        std::cerr << "could not open output segment '" << fileName << "': " << strerror(errno) << std::endl;
+        fail();
+        return false;
+    }
+
+    void* mem = MAP_FAILED;
+    if (reserve(policy.segmentBytes)) {
+        mem = mmap(NULL, policy.segmentBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (mem == MAP_FAILED) {
+        std::cerr << "could not preallocate output segment '" << fileName << "': " << strerror(errno) << std::endl;
+        close(fd);
+        fd = -1;
+        unlink(fileName.c_str());
+        fail();
+        return false;
+    }
+    base       = static_cast<char*>(mem);
+    mappedSize = policy.segmentBytes;
+    setPutArea(0);
+    clock_gettime(CLOCK_MONOTONIC, &startTS.ts);
+
+    // delete the oldest segments, the new one counts as well
+    segments.push_back(next++);
+    while (policy.keep > 0 && segments.size() > policy.keep) {
+        unlink(segmentName(segments.front()).c_str());
+        segments.pop_front();
+    }
+
+    return true;
+}
+
+void SegmentWriter::finishSegment() {
+    if (fd == -1) return;
+
+    const size_t used = pptr() - pbase();
+    munmap(base, mappedSize);
+    if (ftruncate(fd, used) == -1) {
+        std::cerr << "could not truncate output segment: " << strerror(errno) << std::endl;
+    }
+    close(fd);
+    fd         = -1;
+    base       = NULL;
+    mappedSize = 0;
+    setp(NULL, NULL);
+}
+
+bool SegmentWriter::reserve(const size_t size) {
+    // posix_fallocate() falls back to writing zeros if the file system doesn't support allocating space directly
+    if (fallocate(fd, 0, 0, size) == 0) return true;
+    if (errno != EOPNOTSUPP) return false;
+
+    errno = posix_fallocate(fd, 0, size);
+    return errno == 0;
+}
+
+void SegmentWriter::setPutArea(const size_t used) {
+    setp(base, base + mappedSize);
+    // pbump() only takes an int
+    for (size_t left = used; left > 0; ) {
+        const int step = (int)std::min(left, (size_t)INT_MAX);
+        pbump(step);
+        left -= step;
+    }
+}
+
+void SegmentWriter::fail() {
+    // keep what has been written so far
+    finishSegment();
+    failed = true;
+    discarded.resize(minGrowBytes);
+    setp(&discarded[0], &discarded[0] + discarded.size());
+}
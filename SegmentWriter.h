@@ -0,0 +1,90 @@
+#ifndef SEGMENT_WRITER_H
+#define SEGMENT_WRITER_H SEGMENT_WRITER_H
+
+#include "TimeSpec.h"
+
+#include <deque>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include <cstddef>
+
+/// configuration of a @ref SegmentWriter
+struct SegmentPolicy {
+    SegmentPolicy() : segmentBytes(64 * 1024 * 1024), maxAgeSecs(0.0), keep(0) {}
+
+    size_t       segmentBytes; ///< size segments are preallocated to, a segment is rotated once it holds this much
+    double       maxAgeSecs;   ///< rotate segments older than this, 0 for never
+    unsigned int keep;         ///< number of segments kept, older ones are deleted, 0 to keep all
+};
+
+/// stream buffer writing into preallocated, memory-mapped files, rotated into numbered segments
+/// name.0, name.1, ... by size or age, numbering continues after the segments already existing
+/// @note segments are preallocated with fallocate() and written through a shared mapping, so writing doesn't issue
+///       any system call and the file system can allocate contiguous extents, a segment is truncated to the data
+///       written when it is finished, the segment of a killed process ends with zeros
+/// @note segments are only rotated when requested via @ref rotate(), i.e. between two ticks, so the output of a tick
+///       is never split and each segment can start with a header, a tick's output beyond the preallocated size
+///       grows the segment
+class SegmentWriter : public std::streambuf {
+  public:
+    /// creates a writer of segments named @p baseName.N, call @ref open() to start the first one
+    SegmentWriter(const std::string& baseName, const SegmentPolicy& policy);
+
+    /// finishes the current segment
+    ~SegmentWriter();
+
+    /// starts the next segment after the existing ones and deletes old ones according to the policy
+    /// @return false on errors, an error message has been printed then
+    bool open();
+
+    /// returns whether the current segment is full or too old at @p nowTS
+    bool rotationDue(const TimeSpec& nowTS) const;
+
+    /// finishes the current segment, starts the next one and deletes old ones according to the policy
+    /// @return false on errors, an error message has been printed and further output is discarded then
+    bool rotate();
+
+  protected:
+    /// grows the current segment
+    int_type overflow(int_type c);
+
+    /// nothing to do, the data is in the page cache already
+    int sync();
+
+  private:
+    // not copyable, owns the mapping
+    SegmentWriter(const SegmentWriter& other);
+    SegmentWriter& operator=(const SegmentWriter& other);
+
+    /// returns the file name of segment @p number
+    std::string segmentName(const unsigned long number) const;
+
+    /// creates and maps the next segment
+    bool startSegment();
+
+    /// unmaps the current segment and truncates it to the data written
+    void finishSegment();
+
+    /// allocates disk space for the first @p size bytes of the current segment
+    bool reserve(const size_t size);
+
+    /// points the put area to the current segment, @p used bytes of which have been written
+    void setPutArea(const size_t used);
+
+    /// discards all further output after an error
+    void fail();
+
+    const std::string         name;        ///< name of the segments without their number
+    const SegmentPolicy       policy;      ///< size, age and retention of the segments
+    std::deque<unsigned long> segments;    ///< numbers of the existing segments, oldest first
+    unsigned long             next;        ///< number of the next segment
+    int                       fd;          ///< current segment, -1 if none
+    char*                     base;        ///< mapping of the current segment
+    size_t                    mappedSize;  ///< size of the mapping
+    TimeSpec                  startTS;     ///< time the current segment has been started
+    bool                      failed;      ///< writing failed, data is discarded from now on
+    std::vector<char>         discarded;   ///< put area after an error
+};
+
+#endif // SEGMENT_WRITER_H
@@ -0,0 +1,170 @@
+#include "SelfStats.h"
+#include "ProcParser.h"
+#include "ProcReader.h"
+
+#include <iomanip>
+#include <ctime>
+
+/// converts a timeval to nanoseconds
+static uint64_t toNsecs(const timeval& tv) {
+    return (uint64_t)tv.tv_sec * 1000000000ULL + (uint64_t)tv.tv_usec * 1000ULL;
+}
+
+/// converts a timespec to nanoseconds
+static uint64_t toNsecs(const timespec& ts) {
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+uint64_t nowNsecs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return toNsecs(ts);
+}
+
+LatencyHistogram::LatencyHistogram() : buckets(), total(0), sum(0), max(0) {
+}
+
+void LatencyHistogram::add(const uint64_t nsecs) {
+    unsigned int bucket = nsecs == 0 ? 0 : 63 - __builtin_clzll(nsecs);
+    if (bucket >= bucketCount) bucket = bucketCount - 1;
+    ++buckets[bucket];
+    ++total;
+    sum += nsecs;
+    if (nsecs > max) max = nsecs;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (unsigned int bucket = 0; bucket < bucketCount; ++bucket) {
+        buckets[bucket] += other.buckets[bucket];
+    }
+    total += other.total;
+    sum   += other.sum;
+    if (other.max > max) max = other.max;
+}
+
+uint64_t LatencyHistogram::percentile(const double p) const {
+    const uint64_t rank = (uint64_t)(p * total);
+    uint64_t seen = 0;
+    for (unsigned int bucket = 0; bucket < bucketCount; ++bucket) {
+        seen += buckets[bucket];
+        if (seen > rank) {
+            // upper bound of the bucket, but not above the actual maximum
+            const uint64_t bound = (2ULL << bucket) - 1;
+            return bound < max ? bound : max;
+        }
+    }
+    return max;
+}
+
+void LatencyHistogram::print(std::ostream& os, const char* prefix) const {
+    if (total == 0) {
+        os << prefix << "no samples" << std::endl;
+        return;
+    }
+
+    os << prefix << "count " << total
+       << ", avg " << (double)sum / total / 1000.0 << " us"
+       << ", p50 <= " << percentile(0.50) / 1000.0 << " us"
+       << ", p99 <= " << percentile(0.99) / 1000.0 << " us"
+       << ", max " << max / 1000.0 << " us" << std::endl;
+    for (unsigned int bucket = 0; bucket < bucketCount; ++bucket) {
+        if (buckets[bucket] == 0) continue;
+        os << prefix << "  < " << std::setfill(' ') << std::setw(12) << (2ULL << bucket) / 1000.0 << " us: " << buckets[bucket] << std::endl;
+    }
+}
+
+SelfStats::SelfStats(std::ostream& outStream) :
+  os(outStream), selfIO("/proc/self/io"), buffer(), tickTS(), lateness(0),
+  lastUsage(), lastReadCalls(0), lastWriteCalls(0),
+  firstUsage(), firstReadCalls(0), firstWriteCalls(0),
+  ticks(0), skippedTicks(0), latenessHist(), loopHist() {
+    os << std::fixed << std::setprecision(2);
+    readSelf(lastUsage, lastReadCalls, lastWriteCalls);
+    firstUsage      = lastUsage;
+    firstReadCalls  = lastReadCalls;
+    firstWriteCalls = lastWriteCalls;
+}
+
+void SelfStats::writeHeader() {
+    os << "Time,LatenessUs,LoopUs,Processes,SkippedTicks,UserCPUUs,SystemCPUUs,"
+       << "ReadCalls,WriteCalls,VolCtxSwitches,InvolCtxSwitches" << std::endl;
+}
+
+void SelfStats::beginTick(const TimeSpec& scheduledTS) {
+    clock_gettime(CLOCK_MONOTONIC, &tickTS.ts);
+    const uint64_t now       = toNsecs(tickTS.ts);
+    const uint64_t scheduled = toNsecs(scheduledTS.ts);
+    lateness = now > scheduled ? now - scheduled : 0;
+}
+
+void SelfStats::endTick(const size_t processes, const unsigned int skipped) {
+    const uint64_t loop = nowNsecs() - toNsecs(tickTS.ts);
+
+    struct rusage usage;
+    uint64_t readCalls, writeCalls;
+    readSelf(usage, readCalls, writeCalls);
+
+    os << tickTS
+       << "," << lateness / 1000.0
+       << "," << loop / 1000.0
+       << "," << processes
+       << "," << skipped
+       << "," << (toNsecs(usage.ru_utime) - toNsecs(lastUsage.ru_utime)) / 1000.0
+       << "," << (toNsecs(usage.ru_stime) - toNsecs(lastUsage.ru_stime)) / 1000.0
+       << "," << readCalls  - lastReadCalls
+       << "," << writeCalls - lastWriteCalls
+       << "," << usage.ru_nvcsw  - lastUsage.ru_nvcsw
+       << "," << usage.ru_nivcsw - lastUsage.ru_nivcsw
+       << std::endl;
+
+    latenessHist.add(lateness);
+    loopHist.add(loop);
+    ++ticks;
+    skippedTicks  += skipped;
+    lastUsage      = usage;
+    lastReadCalls  = readCalls;
+    lastWriteCalls = writeCalls;
+}
+
+void SelfStats::writeSummary(const SamplerStats* const* samplers, const size_t count) {
+    LatencyHistogram read, parse;
+    for (size_t i = 0; i < count; ++i) {
+        read.merge(samplers[i]->read);
+        parse.merge(samplers[i]->parse);
+    }
+
+    struct rusage usage;
+    uint64_t readCalls, writeCalls;
+    readSelf(usage, readCalls, writeCalls);
+
+    os << "# summary" << std::endl
+       << "# ticks: " << ticks << ", skipped: " << skippedTicks << std::endl
+       << "# user CPU: "   << (toNsecs(usage.ru_utime) - toNsecs(firstUsage.ru_utime)) / 1e6 << " ms"
+       << ", system CPU: " << (toNsecs(usage.ru_stime) - toNsecs(firstUsage.ru_stime)) / 1e6 << " ms" << std::endl
+       << "# read calls: " << readCalls - firstReadCalls
+       << ", write calls: " << writeCalls - firstWriteCalls
+       << ", voluntary context switches: "   << usage.ru_nvcsw  - firstUsage.ru_nvcsw
+       << ", involuntary context switches: " << usage.ru_nivcsw - firstUsage.ru_nivcsw << std::endl;
+    os << "# wakeup lateness:" << std::endl;
+    latenessHist.print(os, "#   ");
+    os << "# sampling loop:" << std::endl;
+    loopHist.print(os, "#   ");
+    os << "# read latency per process:" << std::endl;
+    read.print(os, "#   ");
+    os << "# parse latency per process:" << std::endl;
+    parse.print(os, "#   ");
+}
+
+void SelfStats::readSelf(struct rusage& usage, uint64_t& readCalls, uint64_t& writeCalls) {
+    getrusage(RUSAGE_SELF, &usage);
+
+    // syscr and syscw count all calls of the read and write syscall families
+    readCalls  = 0;
+    writeCalls = 0;
+    const ssize_t len = selfIO.read(buffer);
+    ProcessStatus status;
+    if (len > 0 && ProcParser::parseIO(&buffer[0], len, status)) {
+        readCalls  = status.values[TotReadCalls].u;
+        writeCalls = status.values[TotWriteCalls].u;
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef SELF_STATS_H
+#define SELF_STATS_H SELF_STATS_H
+
+#include "ProcFile.h"
+#include "TimeSpec.h"
+
+#include <iostream>
+#include <stdint.h>
+
+#include <sys/resource.h>
+
+/// histogram of latencies with power-of-two buckets
+class LatencyHistogram {
+  public:
+    /// number of buckets, bucket n holds latencies from 2^n to 2^(n+1) - 1 nanoseconds
+    static const unsigned int bucketCount = 40;
+
+    LatencyHistogram();
+
+    /// adds a latency in nanoseconds
+    void add(const uint64_t nsecs);
+
+    /// adds all latencies of @p other
+    void merge(const LatencyHistogram& other);
+
+    /// returns the number of latencies added
+    uint64_t count() const { return total; }
+
+    /// returns an upper bound of the given percentile (0.0 - 1.0) in nanoseconds
+    uint64_t percentile(const double p) const;
+
+    /// prints all non-empty buckets, one per line, each line starting with @p prefix
+    void print(std::ostream& os, const char* prefix) const;
+
+  private:
+    uint64_t buckets[bucketCount];
+    uint64_t total;
+    uint64_t sum;
+    uint64_t max;
+};
+
+/// latencies measured by a single sampling thread
+struct SamplerStats {
+    SamplerStats() : read(), parse() {}
+
+    LatencyHistogram read;  ///< time spent reading the files of a process
+    LatencyHistogram parse; ///< time spent parsing the files of a process
+};
+
+/// returns the current time of CLOCK_MONOTONIC in nanoseconds, for latency measurements
+uint64_t nowNsecs();
+
+/// measures audria's own overhead and the precision of its ticks,
+/// writes one line per tick and a summary at the end
+class SelfStats {
+  public:
+    /// writes statistics to @p outStream
+    SelfStats(std::ostream& outStream);
+
+    /// writes the column headers
+    void writeHeader();
+
+    /// starts measuring a tick which was supposed to start at @p scheduledTS
+    void beginTick(const TimeSpec& scheduledTS);
+
+    /// ends a tick during which @p processes have been sampled, @p skipped ticks have been lost afterwards
+    void endTick(const size_t processes, const unsigned int skipped);
+
+    /// writes the summary including the latency histograms of all sampling threads
+    void writeSummary(const SamplerStats* const* samplers, const size_t count);
+
+  private:
+    /// reads own resource usage and read/write syscall counts
+    void readSelf(struct rusage& usage, uint64_t& readCalls, uint64_t& writeCalls);
+
+    std::ostream&    os;             ///< stream to write to
+    ProcFile         selfIO;         ///< /proc/self/io, provides syscall counts
+    ReadBuffer       buffer;         ///< buffer for reading @ref selfIO
+    TimeSpec         tickTS;         ///< start of the current tick
+    uint64_t         lateness;       ///< wakeup lateness of the current tick in nanoseconds
+    struct rusage    lastUsage;      ///< resource usage at the end of the previous tick
+    uint64_t         lastReadCalls;  ///< read syscalls at the end of the previous tick
+    uint64_t         lastWriteCalls; ///< write syscalls at the end of the previous tick
+    struct rusage    firstUsage;     ///< resource usage before the first tick
+    uint64_t         firstReadCalls; ///< read syscalls before the first tick
+    uint64_t         firstWriteCalls;///< write syscalls before the first tick
+    uint64_t         ticks;          ///< number of ticks
+    uint64_t         skippedTicks;   ///< number of ticks lost
+    LatencyHistogram latenessHist;   ///< wakeup lateness of all ticks
+    LatencyHistogram loopHist;       ///< time spent in the sampling loop of all ticks
+};
+
+#endif // SELF_STATS_H
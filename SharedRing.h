@@ -0,0 +1,55 @@
+#ifndef SHARED_RING_H
+#define SHARED_RING_H SHARED_RING_H
+
+#include <stdint.h>
+
+/// layout of the POSIX shared memory segment audria publishes its rows to with -m, see @ref SharedRingReader
+/// - header: @ref Header, followed by the ID (see @ref StatusColumns) and type (see @ref ColumnType) of each column
+///           as two uint16_t, padded to @ref alignment
+/// - slots:  @ref slotCount slots of @ref slotSize bytes, each a @ref Slot followed by a record in the binary format,
+///           see @ref BinaryFormat, the n-th record written (starting at 0) is stored in slot n % slotCount
+/// @note all values in host byte order, the segment is only meant to be shared on the same host
+/// @note each slot is protected by a sequence lock: the writer sets its sequence to 2 * n + 1 before writing
+///       the n-th record and to 2 * n + 2 afterwards, a reader has read the n-th record consistently if the sequence
+///       was 2 * n + 2 both before and after copying it, larger values mean it has been overwritten in the meantime
+namespace SharedRing {
+    /// magic bytes at the start of the header
+    const char magic[8] = {'A', 'U', 'D', 'R', 'I', 'A', 'M', '\0'};
+
+    /// version of the layout, written last by the writer once the header is complete
+    const uint32_t version = 1;
+
+    /// alignment of the column descriptions and slots
+    const uint32_t alignment = 64;
+
+    /// fixed part of the header
+    struct Header {
+        char     magic[8];
+        uint32_t version;     ///< @ref SharedRing::version once the segment has been set up
+        uint32_t columnCount; ///< number of columns
+        uint32_t recordSize;  ///< size of a record, see @ref BinaryFormat::recordSize()
+        uint32_t slotSize;    ///< size of a slot including its @ref Slot header
+        uint64_t slotCount;   ///< number of slots
+        uint64_t slotsOffset; ///< offset of the first slot from the start of the segment
+        uint64_t written;     ///< number of records written completely, only increases
+        uint32_t closed;      ///< set once audria has terminated, no more records will be written
+        uint32_t reserved;
+    };
+
+    /// header of each slot
+    struct Slot {
+        uint64_t sequence; ///< sequence lock of the slot
+    };
+
+    /// returns the size of a slot for records of @p recordSize bytes
+    inline uint32_t slotSize(const uint32_t recordSize) {
+        return (sizeof(Slot) + recordSize + 7) / 8 * 8;
+    }
+
+    /// returns the offset of the first slot for @p columnCount columns
+    inline uint64_t slotsOffset(const uint32_t columnCount) {
+        return (sizeof(Header) + columnCount * 2 * sizeof(uint16_t) + alignment - 1) / alignment * alignment;
+    }
+}
+
+#endif // SHARED_RING_H
@@ -0,0 +1,97 @@
+#include "SharedRingOutput.h"
+
+#include <iostream>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+SharedRingOutput::SharedRingOutput(Output* nextOutput, std::ostream& outStream, const std::set<int>& fields) :
+  Output(outStream, fields), next(nextOutput), shmName(), base(NULL), size(0), header(NULL) {
+}
+
+SharedRingOutput::~SharedRingOutput() {
+    if (base) {
+        // readers which have mapped the segment keep it until they unmap it
+        __atomic_store_n(&header->closed, 1, __ATOMIC_RELEASE);
+        munmap(base, size);
+        shm_unlink(shmName.c_str());
+    }
+    delete next;
+}
+
+bool SharedRingOutput::open(const std::string& name, const uint64_t slots) {
+    assert(!base && slots > 0);
+
+    const std::string path = name[0] == '/' ? name : "/" + name;
+    const uint32_t recordSize  = BinaryFormat::recordSize(columns);
+    const uint32_t slotSize    = SharedRing::slotSize(recordSize);
+    const uint64_t slotsOffset = SharedRing::slotsOffset(columns.size());
+
+    // readers of a previous segment of the same name keep their mapping
+    shm_unlink(path.c_str());
+    const int fd = shm_open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        std::cerr << "could not create shared memory segment '" << path << "': " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    // the segment is zero-filled, i.e. no slot holds a record yet
+    const size_t segmentSize = slotsOffset + slots * slotSize;
+    void* mem = MAP_FAILED;
+    if (ftruncate(fd, segmentSize) == 0) {
+        // map all pages right away, publishing rows shall not fault
+        mem = mmap(NULL, segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+    }
+    if (mem == MAP_FAILED) {
+        std::cerr << "could not set up shared memory segment '" << path << "': " << strerror(errno) << std::endl;
+        close(fd);
+        shm_unlink(path.c_str());
+        return false;
+    }
+    close(fd);
+
+    base    = static_cast<char*>(mem);
+    size    = segmentSize;
+    shmName = path;
+    header  = reinterpret_cast<SharedRing::Header*>(base);
+    memcpy(header->magic, SharedRing::magic, sizeof(header->magic));
+    header->columnCount = columns.size();
+    header->recordSize  = recordSize;
+    header->slotSize    = slotSize;
+    header->slotCount   = slots;
+    header->slotsOffset = slotsOffset;
+
+    uint16_t* descriptions = reinterpret_cast<uint16_t*>(base + sizeof(SharedRing::Header));
+    for (unsigned int i = 0; i < columns.size(); ++i) {
+        descriptions[2 * i]     = columns[i];
+        descriptions[2 * i + 1] = statusColumnType[columns[i]];
+    }
+
+    // readers only use the segment once the version is set
+    __atomic_store_n(&header->version, SharedRing::version, __ATOMIC_RELEASE);
+    return true;
+}
+
+void SharedRingOutput::writeHeader() {
+    next->writeHeader();
+}
+
+void SharedRingOutput::writeRow(const TimeSpec& ts, const ProcessStatus& status) {
+    if (base) {
+        // we are the only writer, readers check the sequence before and after copying a record
+        const uint64_t record = header->written;
+        SharedRing::Slot* slot = reinterpret_cast<SharedRing::Slot*>(
+            base + header->slotsOffset + (record % header->slotCount) * header->slotSize);
+        __atomic_store_n(&slot->sequence, 2 * record + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        BinaryFormat::encodeRecord(reinterpret_cast<char*>(slot + 1), columns, ts, status);
+        __atomic_store_n(&slot->sequence, 2 * record + 2, __ATOMIC_RELEASE);
+        __atomic_store_n(&header->written, record + 1, __ATOMIC_RELEASE);
+    }
+
+    next->writeRow(ts, status);
+}
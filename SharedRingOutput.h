@@ -0,0 +1,38 @@
+#ifndef SHARED_RING_OUTPUT_H
+#define SHARED_RING_OUTPUT_H SHARED_RING_OUTPUT_H
+
+#include "Output.h"
+#include "SharedRing.h"
+
+#include <set>
+#include <string>
+
+/// publishes all rows to a POSIX shared memory segment in the layout described in @ref SharedRing,
+/// in addition to writing them to another output
+/// @note rows are published without any system call, the oldest ones are overwritten once the ring is full
+class SharedRingOutput : public Output {
+  public:
+    /// creates an output for the given columns forwarding all rows to @p nextOutput, which it takes ownership of
+    SharedRingOutput(Output* nextOutput, std::ostream& outStream, const std::set<int>& fields);
+    ~SharedRingOutput();
+
+    /// creates the shared memory segment @p name with @p slots slots, replacing an existing one of the same name
+    /// @return false on errors, an error message has been printed then
+    bool open(const std::string& name, const uint64_t slots);
+
+    void writeHeader();
+    void writeRow(const TimeSpec& ts, const ProcessStatus& status);
+
+  private:
+    // not copyable, owns the segment
+    SharedRingOutput(const SharedRingOutput& other);
+    SharedRingOutput& operator=(const SharedRingOutput& other);
+
+    Output*             next;    ///< output all rows are forwarded to
+    std::string         shmName; ///< name of the segment, empty if not open
+    char*               base;    ///< start of the mapped segment, NULL if not open
+    size_t              size;    ///< size of the mapped segment
+    SharedRing::Header* header;  ///< header at the start of the segment
+};
+
+#endif // SHARED_RING_OUTPUT_H
@@ -0,0 +1,110 @@
+#include "SharedRingReader.h"
+#include "Output.h"
+
+#include <algorithm>
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+SharedRingReader::SharedRingReader() :
+  base(NULL), size(0), header(NULL), columns(), record(), nextRecord(0), lost(0) {
+}
+
+SharedRingReader::~SharedRingReader() {
+    if (base) {
+        munmap(const_cast<char*>(base), size);
+    }
+}
+
+bool SharedRingReader::open(const std::string& name) {
+    const std::string path = name[0] == '/' ? name : "/" + name;
+    const int fd = shm_open(path.c_str(), O_RDONLY | O_CLOEXEC, 0);
+    if (fd == -1) {
+        std::cerr << "could not open shared memory segment '" << path << "': " << strerror(errno) << std::endl;
+        return false;
+    }
+    struct stat st;
+    void* mem = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(SharedRing::Header)) {
+        mem = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (mem == MAP_FAILED) {
+        std::cerr << "could not map shared memory segment '" << path << "'" << std::endl;
+        return false;
+    }
+    base   = static_cast<const char*>(mem);
+    size   = st.st_size;
+    header = reinterpret_cast<const SharedRing::Header*>(base);
+
+    if (memcmp(header->magic, SharedRing::magic, sizeof(header->magic)) != 0 ||
+        __atomic_load_n(&header->version, __ATOMIC_ACQUIRE) != SharedRing::version) {
+        std::cerr << "shared memory segment '" << path << "' not set up by audria or unsupported version" << std::endl;
+        return false;
+    }
+    if (header->slotCount == 0 || header->slotSize < sizeof(SharedRing::Slot) + header->recordSize ||
+        header->slotsOffset < SharedRing::slotsOffset(header->columnCount) ||
+        header->slotsOffset + header->slotCount * header->slotSize > size) {
+        std::cerr << "invalid shared memory segment '" << path << "'" << std::endl;
+        return false;
+    }
+
+    const uint16_t* descriptions = reinterpret_cast<const uint16_t*>(base + sizeof(SharedRing::Header));
+    columns.clear();
+    for (uint32_t i = 0; i < header->columnCount; ++i) {
+        const uint16_t id = descriptions[2 * i], type = descriptions[2 * i + 1];
+        if (id >= StatusColumnCount || type != statusColumnType[id]) {
+            std::cerr << "invalid or unknown column in shared memory segment '" << path << "'" << std::endl;
+            return false;
+        }
+        columns.push_back(id);
+    }
+    if (BinaryFormat::recordSize(columns) != header->recordSize) {
+        std::cerr << "invalid record size in shared memory segment '" << path << "'" << std::endl;
+        return false;
+    }
+    record.resize(header->recordSize);
+
+    // older records may be overwritten already, they don't count as lost
+    const uint64_t written = __atomic_load_n(&header->written, __ATOMIC_ACQUIRE);
+    nextRecord = written > header->slotCount ? written - header->slotCount : 0;
+    return true;
+}
+
+bool SharedRingReader::next(TimeSpec& ts, ProcessStatus& status) {
+    if (!base) return false;
+
+    for (;;) {
+        const SharedRing::Slot* slot = reinterpret_cast<const SharedRing::Slot*>(
+            base + header->slotsOffset + (nextRecord % header->slotCount) * header->slotSize);
+        const uint64_t expected = 2 * nextRecord + 2;
+        const uint64_t before = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        if (before < expected) return false;
+
+        if (before == expected) {
+            memcpy(&record[0], slot + 1, record.size());
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&slot->sequence, __ATOMIC_RELAXED) == expected) {
+                ++nextRecord;
+                BinaryFormat::decodeRecord(&record[0], columns, ts, status);
+                return true;
+            }
+        }
+
+        // overwritten while or before copying it, continue with the oldest record still available
+        const uint64_t written = __atomic_load_n(&header->written, __ATOMIC_ACQUIRE);
+        const uint64_t oldest = written > header->slotCount ? written - header->slotCount : 0;
+        const uint64_t resume = std::max(oldest, nextRecord + 1);
+        lost += resume - nextRecord;
+        nextRecord = resume;
+    }
+}
+
+bool SharedRingReader::isClosed() const {
+    return base && __atomic_load_n(&header->closed, __ATOMIC_ACQUIRE) != 0;
+}
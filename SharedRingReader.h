@@ -0,0 +1,51 @@
+#ifndef SHARED_RING_READER_H
+#define SHARED_RING_READER_H SHARED_RING_READER_H
+
+#include "ProcReader.h"
+#include "SharedRing.h"
+#include "TimeSpec.h"
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+/// reads the rows audria publishes to a shared memory segment with -m, see @ref SharedRing,
+/// any number of readers can read the same segment without affecting audria or each other
+/// @note reading a record doesn't require any system call, readers have to poll for new records
+class SharedRingReader {
+  public:
+    SharedRingReader();
+    ~SharedRingReader();
+
+    /// maps the segment @p name read-only and starts at the oldest record still available
+    /// @return false on errors, e.g. if audria hasn't set up the segment yet, an error message has been printed then
+    bool open(const std::string& name);
+
+    /// returns the columns of the records, in ascending order
+    const std::vector<int>& getColumns() const { return columns; }
+
+    /// reads the next record without blocking
+    /// @return false if no new record is available yet
+    bool next(TimeSpec& ts, ProcessStatus& status);
+
+    /// returns the number of records which have been overwritten before they could be read
+    uint64_t getLost() const { return lost; }
+
+    /// returns whether audria has terminated, no more records will be available once @ref next() returns false
+    bool isClosed() const;
+
+  private:
+    // not copyable, owns the mapping
+    SharedRingReader(const SharedRingReader& other);
+    SharedRingReader& operator=(const SharedRingReader& other);
+
+    const char*               base;       ///< start of the mapped segment, NULL if not open
+    size_t                    size;       ///< size of the mapped segment
+    const SharedRing::Header* header;     ///< header at the start of the segment
+    std::vector<int>          columns;    ///< columns of the records
+    std::vector<char>         record;     ///< copy of the record being read
+    uint64_t                  nextRecord; ///< number of the next record to read
+    uint64_t                  lost;       ///< records overwritten before they could be read
+};
+
+#endif // SHARED_RING_READER_H
@@ -0,0 +1,282 @@
+#include "TaskStatsReader.h"
+#include "helper.h"
+#include "definitions.h"
+
+#include <algorithm>
+#include <iostream>
+#include <cassert>
+#include <cstring>
+
+#include <errno.h>
+#include <linux/genetlink.h>
+#include <linux/netlink.h>
+#include <linux/taskstats.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace {
+
+/// size of the payload of a netlink message, large enough for a taskstats reply
+const size_t payloadSize = 1024;
+
+/// a generic netlink message
+struct GenlMessage {
+    struct nlmsghdr   n;
+    struct genlmsghdr g;
+    char              payload[payloadSize];
+};
+
+/// initializes a generic netlink request without any attributes
+void initRequest(GenlMessage& msg, const uint16_t type, const uint8_t cmd, const uint8_t version, const uint32_t seq) {
+    memset(&msg, 0, NLMSG_LENGTH(GENL_HDRLEN));
+    msg.n.nlmsg_len   = NLMSG_LENGTH(GENL_HDRLEN);
+    msg.n.nlmsg_type  = type;
+    msg.n.nlmsg_flags = NLM_F_REQUEST;
+    msg.n.nlmsg_seq   = seq;
+    msg.g.cmd         = cmd;
+    msg.g.version     = version;
+}
+
+/// appends an attribute to a generic netlink message
+void addAttribute(GenlMessage& msg, const uint16_t type, const void* data, const uint16_t len) {
+    assert(NLMSG_ALIGN(msg.n.nlmsg_len) + NLA_HDRLEN + len <= sizeof(msg));
+    struct nlattr* attr = reinterpret_cast<struct nlattr*>(reinterpret_cast<char*>(&msg) + NLMSG_ALIGN(msg.n.nlmsg_len));
+    attr->nla_type = type;
+    attr->nla_len  = NLA_HDRLEN + len;
+    memcpy(reinterpret_cast<char*>(attr) + NLA_HDRLEN, data, len);
+    msg.n.nlmsg_len = NLMSG_ALIGN(msg.n.nlmsg_len) + NLA_ALIGN(attr->nla_len);
+}
+
+/// returns the first attribute of the given type within [@p pos, @p end), NULL if not found
+const struct nlattr* findAttribute(const char* pos, const char* end, const uint16_t type) {
+    while (pos + NLA_HDRLEN <= end) {
+        const struct nlattr* attr = reinterpret_cast<const struct nlattr*>(pos);
+        if (unlikely(attr->nla_len < NLA_HDRLEN || pos + attr->nla_len > end))
+            return NULL;
+        if ((attr->nla_type & NLA_TYPE_MASK) == type)
+            return attr;
+        pos += NLA_ALIGN(attr->nla_len);
+    }
+    return NULL;
+}
+
+/// returns the payload of an attribute
+inline const char* attributeData(const struct nlattr* attr) {
+    return reinterpret_cast<const char*>(attr) + NLA_HDRLEN;
+}
+
+/// receives a single reply with the given sequence number, skipping stale replies
+/// @return length of the reply or -1 on errors, errno is set then
+ssize_t receiveReply(const int sock, const uint32_t seq, GenlMessage& msg) {
+    for (;;) {
+        const ssize_t len = recv(sock, &msg, sizeof(msg), 0);
+        if (unlikely(len < 0)) {
+            return -1;
+        }
+        if (unlikely(len < (ssize_t)NLMSG_HDRLEN || !NLMSG_OK(&msg.n, (size_t)len))) {
+            errno = EBADMSG;
+            return -1;
+        }
+        if (unlikely(msg.n.nlmsg_seq != seq)) {
+            continue; // reply to an earlier request we have given up on
+        }
+        if (msg.n.nlmsg_type == NLMSG_ERROR) {
+            const struct nlmsgerr* err = reinterpret_cast<const struct nlmsgerr*>(NLMSG_DATA(&msg.n));
+            errno = err->error ? -err->error : EBADMSG;
+            return -1;
+        }
+        return len;
+    }
+}
+
+} // namespace
+
+TaskStatsReader::TaskStatsReader() : sock(-1), familyID(0), seq(0) {
+}
+
+TaskStatsReader::~TaskStatsReader() {
+    if (sock != -1) {
+        close(sock);
+    }
+}
+
+bool TaskStatsReader::open() {
+    assert(sock == -1);
+
+    sock = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_GENERIC);
+    if (sock == -1) {
+        std::cerr << "could not open netlink socket: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    if (!resolveFamily()) {
+        std::cerr << "could not resolve taskstats netlink family: " << strerror(errno) << std::endl;
+        close(sock);
+        sock = -1;
+        return false;
+    }
+
+    // check if we are allowed to query taskstats at all
+    ProcessStatus status = ProcessStatus();
+    if (!read(getpid(), status, false)) {
+        std::cerr << "could not query taskstats: " << strerror(errno) << std::endl;
+        close(sock);
+        sock = -1;
+        return false;
+    }
+
+    return true;
+}
+
+bool TaskStatsReader::resolveFamily() {
+    GenlMessage msg;
+    initRequest(msg, GENL_ID_CTRL, CTRL_CMD_GETFAMILY, 1, ++seq);
+    addAttribute(msg, CTRL_ATTR_FAMILY_NAME, TASKSTATS_GENL_NAME, sizeof(TASKSTATS_GENL_NAME));
+
+    if (send(sock, &msg, msg.n.nlmsg_len, 0) == -1) {
+        return false;
+    }
+
+    const ssize_t len = receiveReply(sock, seq, msg);
+    if (len == -1) {
+        return false;
+    }
+
+    const char* attrs = reinterpret_cast<const char*>(&msg) + NLMSG_LENGTH(GENL_HDRLEN);
+    const struct nlattr* idAttr = findAttribute(attrs, reinterpret_cast<const char*>(&msg) + len, CTRL_ATTR_FAMILY_ID);
+    if (!idAttr) {
+        errno = EBADMSG;
+        return false;
+    }
+
+    memcpy(&familyID, attributeData(idAttr), sizeof(familyID));
+    return true;
+}
+
+bool TaskStatsReader::receiveStats(const uint32_t expectedSeq, struct taskstats& stats) {
+    GenlMessage msg;
+    const ssize_t len = receiveReply(sock, expectedSeq, msg);
+    if (unlikely(len == -1)) {
+        return false;
+    }
+
+    // reply contains the statistics nested in an aggregate attribute for either the PID or TGID
+    const char* end = reinterpret_cast<const char*>(&msg) + len;
+    const char* attrs = reinterpret_cast<const char*>(&msg) + NLMSG_LENGTH(GENL_HDRLEN);
+    const struct nlattr* aggrAttr = findAttribute(attrs, end, TASKSTATS_TYPE_AGGR_PID);
+    if (!aggrAttr) {
+        aggrAttr = findAttribute(attrs, end, TASKSTATS_TYPE_AGGR_TGID);
+    }
+    if (unlikely(!aggrAttr)) {
+        errno = EBADMSG;
+        return false;
+    }
+
+    const char* nestedEnd = reinterpret_cast<const char*>(aggrAttr) + aggrAttr->nla_len;
+    const struct nlattr* statsAttr = findAttribute(attributeData(aggrAttr), nestedEnd, TASKSTATS_TYPE_STATS);
+    if (unlikely(!statsAttr)) {
+        errno = EBADMSG;
+        return false;
+    }
+
+    // kernel and header may disagree about the size of the struct, copy the common part
+    memset(&stats, 0, sizeof(stats));
+    memcpy(&stats, attributeData(statsAttr), std::min((size_t)(statsAttr->nla_len - NLA_HDRLEN), sizeof(stats)));
+    return true;
+}
+
+bool TaskStatsReader::read(const int pid, ProcessStatus& status, const bool thread) {
+    assert(sock != -1);
+
+    // the PID request returns the statistics of the main thread only, the TGID request
+    // sums up CPU times and delays of all threads but leaves everything else empty.
+    // send both requests at once and receive both replies in order, a single thread only needs the former.
+    const uint32_t processID = pid;
+    const uint32_t pidSeq  = ++seq;
+    const uint32_t tgidSeq = ++seq;
+    GenlMessage pidMsg;
+    GenlMessage tgidMsg;
+    initRequest(pidMsg,  familyID, TASKSTATS_CMD_GET, TASKSTATS_GENL_VERSION, pidSeq);
+    addAttribute(pidMsg, TASKSTATS_CMD_ATTR_PID, &processID, sizeof(processID));
+    initRequest(tgidMsg, familyID, TASKSTATS_CMD_GET, TASKSTATS_GENL_VERSION, tgidSeq);
+    addAttribute(tgidMsg, TASKSTATS_CMD_ATTR_TGID, &processID, sizeof(processID));
+
+    struct iovec iov[2];
+    iov[0].iov_base = &pidMsg;
+    iov[0].iov_len  = NLMSG_ALIGN(pidMsg.n.nlmsg_len);
+    iov[1].iov_base = &tgidMsg;
+    iov[1].iov_len  = tgidMsg.n.nlmsg_len;
+
+    struct sockaddr_nl kernelAddr;
+    memset(&kernelAddr, 0, sizeof(kernelAddr));
+    kernelAddr.nl_family = AF_NETLINK;
+
+    struct msghdr hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.msg_name    = &kernelAddr;
+    hdr.msg_namelen = sizeof(kernelAddr);
+    hdr.msg_iov     = iov;
+    hdr.msg_iovlen  = thread ? 1 : 2;
+
+    if (unlikely(sendmsg(sock, &hdr, 0) == -1)) {
+        return false;
+    }
+
+    struct taskstats threadStats;
+    struct taskstats processStats;
+    // always receive both replies, otherwise the second one would be left in the socket
+    const bool gotThread = receiveStats(pidSeq, threadStats);
+    const int threadErrno = errno;
+    const bool gotProcess = thread || receiveStats(tgidSeq, processStats);
+    if (unlikely(!gotThread || !gotProcess)) {
+        if (!gotThread)
+            errno = threadErrno;
+        return false; // process may already have been terminated
+    }
+
+    const size_t nameLen = strnlen(threadStats.ac_comm, std::min((size_t)TS_COMM_LEN, maxNameLength - 1));
+    memcpy(status.name, threadStats.ac_comm, nameLen);
+    status.name[nameLen] = '\0';
+    status.setValid(Name);
+
+    status.setInteger(PID,  threadStats.ac_pid);
+    status.setInteger(PPID, threadStats.ac_ppid);
+    status.setInteger(Nice, (int8_t)threadStats.ac_nice);
+
+    // CPU times are reported in microseconds
+    const struct taskstats& totalStats = thread ? threadStats : processStats;
+    const double hertz = (double)getHertz();
+    status.setCounter(UserTimeJiffies,   (uint64_t)(totalStats.ac_utime * hertz / 1000000.0));
+    status.setCounter(SystemTimeJiffies, (uint64_t)(totalStats.ac_stime * hertz / 1000000.0));
+    status.setReal(RunTimeSecs, threadStats.ac_etime / 1000000.0);
+
+    status.setCounter(VmPeakkB, threadStats.hiwater_vm);
+    status.setCounter(VmHWMkB,  threadStats.hiwater_rss);
+
+    status.setCounter(CPUDelayTotalNs,    totalStats.cpu_delay_total);
+    status.setCounter(BlkIODelayTotalNs,  totalStats.blkio_delay_total);
+    status.setCounter(SwapinDelayTotalNs, totalStats.swapin_delay_total);
+
+    return true;
+}
+
+bool TaskStatsReader::providesColumn(const int column) {
+    switch (column) {
+        case Name:
+        case PID:
+        case PPID:
+        case Nice:
+        case UserTimeJiffies:
+        case SystemTimeJiffies:
+        case RunTimeSecs:
+        case VmPeakkB:
+        case VmHWMkB:
+        case CPUDelayTotalNs:
+        case BlkIODelayTotalNs:
+        case SwapinDelayTotalNs:
+            return true;
+        default:
+            return false;
+    }
+}
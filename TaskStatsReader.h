@@ -0,0 +1,57 @@
+#ifndef TASK_STATS_READER_H
+#define TASK_STATS_READER_H TASK_STATS_READER_H
+
+#include "ProcReader.h"
+
+#include <cstdint>
+
+struct taskstats;
+
+/// reads process statistics via the generic netlink taskstats interface,
+/// alternative to parsing the text files in /proc/pid/
+/// @note usually requires root privileges or the CAP_NET_ADMIN capability
+/// @note I/O counters and page faults are only reported per thread by taskstats,
+///       these are still read from /proc/pid/
+class TaskStatsReader {
+  public:
+    TaskStatsReader();
+    ~TaskStatsReader();
+
+    /// opens the netlink socket, resolves the taskstats family and checks if we are allowed to use it
+    /// @return false if taskstats is not available, an error message has been printed then
+    bool open();
+
+    /// returns whether taskstats is available
+    bool isOpen() const { return sock != -1; }
+
+    /// queries taskstats for the given process and fills all columns provided by taskstats:
+    /// @ref Name, @ref PID, @ref PPID, @ref Nice, @ref UserTimeJiffies, @ref SystemTimeJiffies,
+    /// @ref RunTimeSecs, @ref VmPeakkB, @ref VmHWMkB and the delay accounting columns
+    /// @param thread whether @p pid is the TID of a single thread, whose own CPU times and delays are used
+    ///        instead of the sum of all threads of its process
+    /// @return false on errors, e.g. if the process has been terminated
+    bool read(const int pid, ProcessStatus& status, const bool thread);
+
+    /// returns whether the given column is provided by @ref read()
+    static bool providesColumn(const int column);
+
+  private:
+    // not copyable, owns the socket
+    TaskStatsReader(const TaskStatsReader& other);
+    TaskStatsReader& operator=(const TaskStatsReader& other);
+
+    /// resolves the ID of the taskstats generic netlink family
+    /// @return false on errors
+    bool resolveFamily();
+
+    /// receives the taskstats reply to the request with sequence number @p expectedSeq
+    /// and copies the contained statistics to @p stats
+    /// @return false on errors
+    bool receiveStats(const uint32_t expectedSeq, struct taskstats& stats);
+
+    int      sock;     ///< netlink socket, -1 if not open
+    uint16_t familyID; ///< ID of the taskstats generic netlink family
+    uint32_t seq;      ///< sequence number of the last request
+};
+
+#endif // TASK_STATS_READER_H
@@ -0,0 +1,19 @@
+#include <iostream>
+
+// tests of the single modules, see the respective *Test.cpp
+void testTimeSpec();
+void testProcParser();
+void testTickScheduler();
+void testOutput();
+void testCompressedFormat();
+
+int main() {
+    testTimeSpec();
+    testProcParser();
+    testTickScheduler();
+    testOutput();
+    testCompressedFormat();
+
+    std::cout << "all tests passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,85 @@
+#include "TickScheduler.h"
+
+#include <iostream>
+
+TickScheduler::TickScheduler(const Policy overloadPolicy, const double intervalSecs) :
+  policy(overloadPolicy), baseTS(intervalSecs), intervalTS(intervalSecs), wakeupTS(), slices(1), slice(0), tick(0),
+  lateTicks(0), grownBusySecs(0.0) {
+}
+
+void TickScheduler::start(const TimeSpec& startTS) {
+    wakeupTS = startTS;
+}
+
+void TickScheduler::setInterval(const double intervalSecs, const TimeSpec& nowTS) {
+    wakeupTS  -= intervalTS;
+    baseTS     = TimeSpec(intervalSecs);
+    intervalTS = baseTS;
+    wakeupTS  += intervalTS;
+    if (nowTS > wakeupTS) {
+        wakeupTS = nowTS;
+    }
+    lateTicks = 0;
+}
+
+unsigned int TickScheduler::endTick(const TimeSpec& nowTS) {
+    const double busySecs = nowTS > wakeupTS ? (nowTS - wakeupTS).seconds() : 0.0;
+    const bool overloaded = busySecs > intervalTS.seconds();
+    const bool idle       = busySecs < intervalTS.seconds() / 4;
+
+    switch (policy) {
+        case Skip:
+            break;
+        case Stretch:
+            // leave some headroom, otherwise the next iteration is likely to be late again
+            if (overloaded) {
+                intervalTS = TimeSpec(busySecs * 1.25);
+                std::cerr << "warning: interval too high, cannot keep up!"
+                          << " (stretching it to " << intervalTS << " seconds)" << std::endl;
+            } else if (idle && baseTS < intervalTS) {
+                const TimeSpec halfTS(intervalTS.seconds() / 2);
+                intervalTS = baseTS < halfTS ? halfTS : baseTS;
+            }
+            break;
+        case Stagger:
+            // a single late iteration may be a hiccup, costs which don't depend on the number of processes read,
+            // e.g. listing /proc with -a, cannot be spread, so stop spreading further once it hardly helps anymore
+            // unless iterations get even longer
+            lateTicks = overloaded ? lateTicks + 1 : 0;
+            if (lateTicks >= 2 && slices < maxSlices &&
+                (slices == 1 || busySecs < grownBusySecs * 0.75 || busySecs > grownBusySecs * 1.5)) {
+                lateTicks = 0;
+                grownBusySecs = busySecs;
+                slices *= 2;
+                std::cerr << "warning: interval too high, cannot keep up!"
+                          << " (reading each process every " << slices << " iterations)" << std::endl;
+            } else if (idle && slices > 1) {
+                slices /= 2;
+            }
+            ++tick;
+            slice = tick % slices;
+            break;
+    }
+
+    // calculate next wakeup time and make sure it is in the future
+    wakeupTS += intervalTS;
+    unsigned int toSkip = 0;
+    if (nowTS > wakeupTS) {
+        if (policy != Skip) {
+            // start the next iteration right away, the interval has been adapted already
+            wakeupTS = nowTS;
+            return 0;
+        }
+
+        const TimeSpec diffTS = nowTS - wakeupTS;
+        do {
+            wakeupTS += intervalTS;
+            ++toSkip;
+        } while (nowTS > wakeupTS);
+        std::cerr << "warning: interval too high, cannot keep up!"
+                  << " (" << diffTS << " seconds behind,"
+                  << " skipping " << toSkip << " iterations)" << std::endl;
+    }
+
+    return toSkip;
+}
@@ -0,0 +1,53 @@
+#ifndef TICK_SCHEDULER_H
+#define TICK_SCHEDULER_H TICK_SCHEDULER_H
+
+#include "TimeSpec.h"
+
+/// schedules the iterations of the main loop and decides what to do if an iteration takes longer than the interval
+/// @note an iteration counts as overloaded if it ends after the scheduled start of the next one,
+///       adaptive policies return to the configured interval once iterations take less than a quarter of it
+class TickScheduler {
+  public:
+    /// what to do if iterations take longer than the interval
+    typedef enum {
+        Skip,    ///< skip the iterations we cannot keep up with, losing their data (default)
+        Stretch, ///< stretch the interval to the time an iteration takes
+        Stagger  ///< spread the processes round-robin over several iterations, each one is read less often
+    } Policy;
+
+    /// creates a scheduler for the given interval in seconds
+    TickScheduler(const Policy overloadPolicy, const double intervalSecs);
+
+    /// schedules the first iteration at @p startTS
+    void start(const TimeSpec& startTS);
+
+    /// returns the time the current iteration has been scheduled for
+    const TimeSpec& scheduled() const { return wakeupTS; }
+
+    /// returns whether the process with the given PID is read in the current iteration
+    bool isDue(const int pid) const { return slices == 1 || (unsigned int)pid % slices == slice; }
+
+    /// changes the configured interval at @p nowTS, the next iteration follows the previous one by the new interval
+    /// but doesn't start before @p nowTS
+    void setInterval(const double intervalSecs, const TimeSpec& nowTS);
+
+    /// ends the current iteration at @p nowTS and schedules the next one
+    /// @return number of iterations skipped, always 0 unless the policy is @ref Skip
+    unsigned int endTick(const TimeSpec& nowTS);
+
+  private:
+    /// maximum number of iterations the processes are spread over
+    static const unsigned int maxSlices = 1024;
+
+    Policy       policy;     ///< what to do if iterations take too long
+    TimeSpec     baseTS;     ///< configured interval
+    TimeSpec     intervalTS; ///< current interval, longer than @ref baseTS while stretched
+    TimeSpec     wakeupTS;   ///< scheduled start of the current iteration
+    unsigned int slices;     ///< number of iterations the processes are spread over
+    unsigned int slice;      ///< processes read in the current iteration, see @ref isDue()
+    unsigned long tick;      ///< number of iterations so far
+    unsigned int lateTicks;  ///< number of consecutive iterations which took longer than the interval
+    double       grownBusySecs; ///< duration of the iteration before the processes have been spread further
+};
+
+#endif // TICK_SCHEDULER_H
@@ -0,0 +1,177 @@
+#include "TickScheduler.h"
+
+#include <iostream>
+#include <sstream>
+#include <cassert>
+
+/// returns the number of iterations the processes are spread over, derived from the PIDs due now
+static unsigned int slicesOf(const TickScheduler& scheduler) {
+    const int pids = 1024; // maximum number of slices
+    int due = 0;
+    for (int pid = 0; pid < pids; ++pid) {
+        if (scheduler.isDue(pid)) ++due;
+    }
+    assert(due > 0 && pids % due == 0);
+    return pids / due;
+}
+
+/// ends the current iteration @p busySecs after its scheduled start
+static unsigned int endTickAfter(TickScheduler& scheduler, const double busySecs) {
+    return scheduler.endTick(scheduler.scheduled() + TimeSpec(busySecs));
+}
+
+static void testSkip() {
+    TickScheduler scheduler(TickScheduler::Skip, 1.0);
+    scheduler.start(TimeSpec(100, 0));
+    assert(scheduler.scheduled() == TimeSpec(100, 0));
+
+    assert(endTickAfter(scheduler, 0.5) == 0);
+    assert(scheduler.scheduled() == TimeSpec(101, 0));
+
+    // an iteration taking exactly the interval is not late
+    assert(endTickAfter(scheduler, 1.0) == 0);
+    assert(scheduler.scheduled() == TimeSpec(102, 0));
+
+    // ending at 105.5, iterations at 103, 104 and 105 are skipped
+    assert(endTickAfter(scheduler, 3.5) == 3);
+    assert(scheduler.scheduled() == TimeSpec(106, 0));
+    assert(slicesOf(scheduler) == 1);
+}
+
+static void testStretch() {
+    TickScheduler scheduler(TickScheduler::Stretch, 1.0);
+    scheduler.start(TimeSpec(100, 0));
+
+    // the interval grows to 1.25 times the duration of a late iteration, none is skipped
+    assert(endTickAfter(scheduler, 2.0) == 0);
+    assert(scheduler.scheduled() == TimeSpec(102, 500000000));
+
+    // longer than a quarter of the interval, it is kept
+    assert(endTickAfter(scheduler, 1.0) == 0);
+    assert(scheduler.scheduled() == TimeSpec(105, 0));
+
+    // shorter than a quarter, it is halved, but not below the configured interval
+    assert(endTickAfter(scheduler, 0.5) == 0);
+    assert(scheduler.scheduled() == TimeSpec(106, 250000000));
+    assert(endTickAfter(scheduler, 0.25) == 0);
+    assert(scheduler.scheduled() == TimeSpec(107, 250000000));
+    assert(endTickAfter(scheduler, 0.0) == 0);
+    assert(scheduler.scheduled() == TimeSpec(108, 250000000));
+
+    // stretching again leaves headroom after the late iteration
+    assert(endTickAfter(scheduler, 4.0) == 0);
+    assert(scheduler.scheduled() == TimeSpec(113, 250000000));
+    assert(slicesOf(scheduler) == 1);
+}
+
+static void testStagger() {
+    TickScheduler scheduler(TickScheduler::Stagger, 1.0);
+    scheduler.start(TimeSpec(0, 0));
+
+    // a single late iteration may be a hiccup, the next one starts right away
+    assert(endTickAfter(scheduler, 1.5) == 0);
+    assert(scheduler.scheduled() == TimeSpec(1, 500000000));
+    assert(slicesOf(scheduler) == 1);
+    endTickAfter(scheduler, 0.5);
+    assert(scheduler.scheduled() == TimeSpec(2, 500000000));
+    endTickAfter(scheduler, 1.5);
+    assert(slicesOf(scheduler) == 1);
+
+    // two consecutive late iterations spread the processes over twice as many iterations
+    endTickAfter(scheduler, 1.5);
+    assert(slicesOf(scheduler) == 2);
+
+    // each process is read every other iteration
+    const bool due = scheduler.isDue(0);
+    assert(scheduler.isDue(1) != due && scheduler.isDue(2) == due);
+    endTickAfter(scheduler, 0.5);
+    assert(scheduler.isDue(0) != due && scheduler.isDue(1) == due);
+    endTickAfter(scheduler, 0.5);
+    assert(scheduler.isDue(0) == due);
+
+    // no further spreading while iterations take between 0.75 and 1.5 times as long as before
+    for (int i = 0; i < 4; ++i) {
+        endTickAfter(scheduler, 1.2);
+        endTickAfter(scheduler, 2.2);
+    }
+    assert(slicesOf(scheduler) == 2);
+
+    // iterations having become shorter show that spreading helps
+    endTickAfter(scheduler, 0.5);
+    endTickAfter(scheduler, 1.1);
+    assert(slicesOf(scheduler) == 2);
+    endTickAfter(scheduler, 1.1);
+    assert(slicesOf(scheduler) == 4);
+
+    // just as iterations having become considerably longer
+    endTickAfter(scheduler, 1.7);
+    endTickAfter(scheduler, 1.7);
+    assert(slicesOf(scheduler) == 8);
+
+    // iterations shorter than a quarter of the interval gather the processes again, one step at a time
+    endTickAfter(scheduler, 0.3);
+    assert(slicesOf(scheduler) == 8);
+    endTickAfter(scheduler, 0.2);
+    assert(slicesOf(scheduler) == 4);
+    endTickAfter(scheduler, 0.2);
+    assert(slicesOf(scheduler) == 2);
+    endTickAfter(scheduler, 0.0);
+    assert(slicesOf(scheduler) == 1);
+    endTickAfter(scheduler, 0.0);
+    assert(slicesOf(scheduler) == 1);
+
+    // the processes are spread over at most 1024 iterations
+    double busySecs = 2.0;
+    for (int i = 0; i < 12; ++i) {
+        endTickAfter(scheduler, busySecs);
+        endTickAfter(scheduler, busySecs);
+        busySecs *= 2;
+    }
+    assert(slicesOf(scheduler) == 1024);
+}
+
+static void testSetInterval() {
+    TickScheduler scheduler(TickScheduler::Stretch, 1.0);
+    scheduler.start(TimeSpec(100, 0));
+    endTickAfter(scheduler, 0.5);
+    assert(scheduler.scheduled() == TimeSpec(101, 0));
+
+    // the next iteration follows the previous one by the new interval
+    scheduler.setInterval(3.0, TimeSpec(100, 750000000));
+    assert(scheduler.scheduled() == TimeSpec(103, 0));
+
+    // but doesn't start in the past
+    scheduler.setInterval(0.5, TimeSpec(101, 500000000));
+    assert(scheduler.scheduled() == TimeSpec(101, 500000000));
+
+    // a stretched interval is replaced by the new one
+    endTickAfter(scheduler, 2.0);
+    assert(scheduler.scheduled() == TimeSpec(104, 0));
+    scheduler.setInterval(1.0, TimeSpec(102, 0));
+    assert(scheduler.scheduled() == TimeSpec(102, 500000000));
+    endTickAfter(scheduler, 0.5);
+    assert(scheduler.scheduled() == TimeSpec(103, 500000000));
+
+    // a late iteration before the change doesn't count towards spreading the processes
+    TickScheduler staggered(TickScheduler::Stagger, 1.0);
+    staggered.start(TimeSpec(0, 0));
+    endTickAfter(staggered, 1.5);
+    staggered.setInterval(1.0, staggered.scheduled());
+    endTickAfter(staggered, 1.5);
+    assert(slicesOf(staggered) == 1);
+    endTickAfter(staggered, 1.5);
+    assert(slicesOf(staggered) == 2);
+}
+
+void testTickScheduler() {
+    // overload warnings are expected here
+    std::ostringstream warnings;
+    std::streambuf* cerrBuf = std::cerr.rdbuf(warnings.rdbuf());
+
+    testSkip();
+    testStretch();
+    testStagger();
+    testSetInterval();
+
+    std::cerr.rdbuf(cerrBuf);
+}
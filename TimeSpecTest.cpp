@@ -1,9 +1,8 @@
 #include "TimeSpec.h"
 
-#include <iostream>
 #include <cassert>
 
-int main() {
+void testTimeSpec() {
     TimeSpec ts1;
     TimeSpec ts2;
 
@@ -52,7 +51,4 @@ int main() {
     assert(ts1.sec() == 2 && ts1.nsec() == 400000000);
     ts1 += ts2;
     assert(ts1.sec() == 4 && ts1.nsec() == 100000000);
-
-    std::cout << "all tests passed" << std::endl;
-    return 0;
 }
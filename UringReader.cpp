@@ -0,0 +1,206 @@
+#include "UringReader.h"
+#include "definitions.h"
+
+#include <algorithm>
+#include <iostream>
+#include <cassert>
+#include <cstring>
+
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// note: we talk to the kernel directly instead of depending on liburing
+
+static inline int ioUringSetup(const unsigned int entries, struct io_uring_params* params) {
+    return syscall(__NR_io_uring_setup, entries, params);
+}
+
+static inline int ioUringEnter(const int fd, const unsigned int toSubmit, const unsigned int minComplete, const unsigned int flags) {
+    return syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, NULL, 0);
+}
+
+static inline int ioUringRegister(const int fd, const unsigned int opcode, void* arg, const unsigned int args) {
+    return syscall(__NR_io_uring_register, fd, opcode, arg, args);
+}
+
+const size_t UringReader::slotSize;
+
+UringReader::UringReader() :
+  ringFd(-1), fixedBuffers(false), buffer(NULL),
+  sqRing(NULL), sqRingSize(0), cqRing(NULL), cqRingSize(0), sqes(NULL), sqesSize(0),
+  sqTail(NULL), sqMask(0), sqArray(NULL), cqHead(NULL), cqTail(NULL), cqMask(0), cqes(NULL),
+  queued(0), results() {
+}
+
+UringReader::~UringReader() {
+    close();
+}
+
+bool UringReader::open(const unsigned int maxReads) {
+    assert(ringFd == -1);
+    assert(maxReads > 0);
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ringFd = ioUringSetup(maxReads, &params);
+    if (ringFd == -1) {
+        std::cerr << "could not set up io_uring: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    // map submission and completion queue rings, newer kernels allow mapping both at once
+    sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    const bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (singleMmap) {
+        sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+    }
+
+    sqRing = mmap(NULL, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+    if (sqRing == MAP_FAILED) {
+        sqRing = NULL;
+        std::cerr << "could not map io_uring submission queue: " << strerror(errno) << std::endl;
+        close();
+        return false;
+    }
+
+    if (singleMmap) {
+        cqRing = sqRing;
+    } else {
+        cqRing = mmap(NULL, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+        if (cqRing == MAP_FAILED) {
+            cqRing = NULL;
+            std::cerr << "could not map io_uring completion queue: " << strerror(errno) << std::endl;
+            close();
+            return false;
+        }
+    }
+
+    sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    void* sqesMap = mmap(NULL, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+    if (sqesMap == MAP_FAILED) {
+        std::cerr << "could not map io_uring submission queue entries: " << strerror(errno) << std::endl;
+        close();
+        return false;
+    }
+    sqes = static_cast<struct io_uring_sqe*>(sqesMap);
+
+    char* sqPtr = static_cast<char*>(sqRing);
+    char* cqPtr = static_cast<char*>(cqRing);
+    sqTail  = reinterpret_cast<unsigned*>(sqPtr + params.sq_off.tail);
+    sqMask  = *reinterpret_cast<unsigned*>(sqPtr + params.sq_off.ring_mask);
+    sqArray = reinterpret_cast<unsigned*>(sqPtr + params.sq_off.array);
+    cqHead  = reinterpret_cast<unsigned*>(cqPtr + params.cq_off.head);
+    cqTail  = reinterpret_cast<unsigned*>(cqPtr + params.cq_off.tail);
+    cqMask  = *reinterpret_cast<unsigned*>(cqPtr + params.cq_off.ring_mask);
+    cqes    = reinterpret_cast<struct io_uring_cqe*>(cqPtr + params.cq_off.cqes);
+
+    // one slot per read, register it with the kernel to save mapping it on each read
+    results.resize(maxReads);
+    void* bufferMap = mmap(NULL, maxReads * slotSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (bufferMap == MAP_FAILED) {
+        std::cerr << "could not allocate io_uring read buffer: " << strerror(errno) << std::endl;
+        close();
+        return false;
+    }
+    buffer = static_cast<char*>(bufferMap);
+
+    struct iovec iov;
+    iov.iov_base = buffer;
+    iov.iov_len  = maxReads * slotSize;
+    fixedBuffers = ioUringRegister(ringFd, IORING_REGISTER_BUFFERS, &iov, 1) == 0;
+    // not fatal, e.g. if exceeding RLIMIT_MEMLOCK, we just use unregistered buffers then
+
+    return true;
+}
+
+void UringReader::close() {
+    if (buffer) {
+        munmap(buffer, results.size() * slotSize);
+        buffer = NULL;
+    }
+    if (sqes) {
+        munmap(sqes, sqesSize);
+        sqes = NULL;
+    }
+    if (cqRing && cqRing != sqRing) {
+        munmap(cqRing, cqRingSize);
+    }
+    cqRing = NULL;
+    if (sqRing) {
+        munmap(sqRing, sqRingSize);
+        sqRing = NULL;
+    }
+    if (ringFd != -1) {
+        ::close(ringFd);
+        ringFd = -1;
+    }
+    results.clear();
+}
+
+unsigned int UringReader::add(const int fd) {
+    assert(ringFd != -1);
+    assert(queued < results.size());
+
+    const unsigned int index = queued++;
+    const unsigned tail = *sqTail + index;
+
+    struct io_uring_sqe* sqe = &sqes[tail & sqMask];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode    = fixedBuffers ? IORING_OP_READ_FIXED : IORING_OP_READ;
+    sqe->fd        = fd;
+    sqe->addr      = reinterpret_cast<unsigned long>(buffer + index * slotSize);
+    sqe->len       = slotSize - 1; // leave room for the terminating NUL
+    sqe->off       = 0;
+    sqe->buf_index = 0;
+    sqe->user_data = index;
+    sqArray[tail & sqMask] = tail & sqMask;
+
+    return index;
+}
+
+bool UringReader::submit() {
+    assert(ringFd != -1);
+
+    const unsigned int toComplete = queued;
+    queued = 0;
+    if (toComplete == 0)
+        return true;
+
+    // publish new entries to the kernel
+    __atomic_store_n(sqTail, *sqTail + toComplete, __ATOMIC_RELEASE);
+
+    unsigned int toSubmit = toComplete;
+    unsigned int completed = 0;
+    while (completed < toComplete) {
+        const int ret = ioUringEnter(ringFd, toSubmit, toComplete - completed, IORING_ENTER_GETEVENTS);
+        if (unlikely(ret == -1)) {
+            if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+                continue;
+            std::cerr << "could not submit io_uring reads: " << strerror(errno) << std::endl;
+            close(); // ring is in an unknown state now
+            return false;
+        }
+        toSubmit -= std::min(toSubmit, (unsigned int)ret);
+
+        // reap completions
+        unsigned head = *cqHead;
+        const unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head) {
+            const struct io_uring_cqe* cqe = &cqes[head & cqMask];
+            assert(cqe->user_data < results.size());
+            results[cqe->user_data] = cqe->res;
+            if (likely(cqe->res >= 0)) {
+                buffer[cqe->user_data * slotSize + cqe->res] = '\0';
+            }
+            ++completed;
+        }
+        __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+    }
+
+    return true;
+}
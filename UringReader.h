@@ -0,0 +1,78 @@
+#ifndef URING_READER_H
+#define URING_READER_H URING_READER_H
+
+#include <vector>
+
+#include <sys/types.h>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+/// reads files in batches via io_uring, all reads of a batch are submitted and
+/// reaped with a single system call instead of one system call per file
+/// @note each read fetches the whole file (up to @ref slotSize - 1 bytes) starting at offset 0
+///       into its own slot of a buffer registered with the kernel
+class UringReader {
+  public:
+    /// size of each read slot, reads returning slotSize - 1 bytes may have been truncated
+    static const size_t slotSize = 4096;
+
+    UringReader();
+    ~UringReader();
+
+    /// sets up the ring for batches of up to @p maxReads reads and registers the read buffer
+    /// @return false if io_uring is not available, an error message has been printed then
+    bool open(const unsigned int maxReads);
+
+    /// returns whether io_uring is available
+    bool isOpen() const { return ringFd != -1; }
+
+    /// returns the maximum number of reads per batch
+    unsigned int capacity() const { return results.size(); }
+
+    /// adds a read of the whole file @p fd to the current batch
+    /// @return index of the read within the batch
+    unsigned int add(const int fd);
+
+    /// submits all added reads, waits for their completion and starts a new batch
+    /// @return false on errors, all reads have to be considered failed and the ring is closed then
+    bool submit();
+
+    /// returns the result of read @p index of the last batch:
+    /// the number of bytes read or -errno on errors
+    ssize_t result(const unsigned int index) const { return results[index]; }
+
+    /// returns the NUL-terminated data of read @p index of the last batch
+    const char* data(const unsigned int index) const { return buffer + index * slotSize; }
+
+  private:
+    // not copyable, owns the ring
+    UringReader(const UringReader& other);
+    UringReader& operator=(const UringReader& other);
+
+    /// unmaps everything and closes the ring
+    void close();
+
+    int           ringFd;       ///< io_uring file descriptor, -1 if not open
+    bool          fixedBuffers; ///< whether @ref buffer has been registered with the kernel
+    char*         buffer;       ///< read buffer, one slot per read
+    void*         sqRing;       ///< mapped submission queue ring
+    size_t        sqRingSize;   ///< size of @ref sqRing
+    void*         cqRing;       ///< mapped completion queue ring, may equal @ref sqRing
+    size_t        cqRingSize;   ///< size of @ref cqRing
+    io_uring_sqe* sqes;         ///< mapped submission queue entries
+    size_t        sqesSize;     ///< size of @ref sqes
+
+    unsigned*     sqTail;       ///< submission queue tail, written by us
+    unsigned      sqMask;       ///< submission queue index mask
+    unsigned*     sqArray;      ///< submission queue index array
+    unsigned*     cqHead;       ///< completion queue head, written by us
+    unsigned*     cqTail;       ///< completion queue tail, written by the kernel
+    unsigned      cqMask;       ///< completion queue index mask
+    io_uring_cqe* cqes;         ///< completion queue entries
+
+    unsigned int         queued;  ///< number of reads added to the current batch
+    std::vector<ssize_t> results; ///< results of the reads of the last batch
+};
+
+#endif // URING_READER_H
@@ -0,0 +1,64 @@
+#include "WorkerPool.h"
+
+#include <iostream>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+WorkerPool::WorkerPool(const unsigned int workers) :
+  threads(), threadArgs(workers > 1 ? workers - 1 : 0), startBarrier(), endBarrier(),
+  job(NULL), context(NULL), stop(false) {
+    assert(workers > 0);
+
+    pthread_barrier_init(&startBarrier, NULL, threadArgs.size() + 1);
+    pthread_barrier_init(&endBarrier,   NULL, threadArgs.size() + 1);
+
+    for (unsigned int i = 0; i < threadArgs.size(); ++i) {
+        threadArgs[i].pool   = this;
+        threadArgs[i].worker = i + 1;
+        pthread_t thread;
+        const int err = pthread_create(&thread, NULL, threadMain, &threadArgs[i]);
+        if (err != 0) {
+            std::cerr << "could not create thread: " << strerror(err) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        threads.push_back(thread);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    stop = true;
+    pthread_barrier_wait(&startBarrier);
+    for (unsigned int i = 0; i < threads.size(); ++i) {
+        pthread_join(threads[i], NULL);
+    }
+
+    pthread_barrier_destroy(&startBarrier);
+    pthread_barrier_destroy(&endBarrier);
+}
+
+void WorkerPool::run(Job newJob, void* newContext) {
+    assert(newJob);
+    job     = newJob;
+    context = newContext;
+
+    pthread_barrier_wait(&startBarrier);
+    job(context, 0);
+    pthread_barrier_wait(&endBarrier);
+}
+
+void* WorkerPool::threadMain(void* arg) {
+    const ThreadArg& threadArg = *static_cast<ThreadArg*>(arg);
+    WorkerPool& pool = *threadArg.pool;
+
+    for (;;) {
+        // barriers order all accesses to job, context and stop
+        pthread_barrier_wait(&pool.startBarrier);
+        if (pool.stop)
+            break;
+        pool.job(pool.context, threadArg.worker);
+        pthread_barrier_wait(&pool.endBarrier);
+    }
+
+    return NULL;
+}
@@ -0,0 +1,48 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H WORKER_POOL_H
+
+#include <vector>
+
+#include <pthread.h>
+
+/// runs a job on a fixed number of threads, the calling thread takes part as worker 0
+/// @note threads are created once and wait for jobs in between
+class WorkerPool {
+  public:
+    /// job to run, called once on each worker with the worker's number
+    typedef void (*Job)(void* context, const unsigned int worker);
+
+    /// creates a pool of @p workers workers, i.e. @p workers - 1 additional threads
+    WorkerPool(const unsigned int workers);
+    ~WorkerPool();
+
+    /// runs @p job on all workers and waits until all of them have finished
+    void run(Job job, void* context);
+
+    /// returns the number of workers including the calling thread
+    unsigned int size() const { return threads.size() + 1; }
+
+  private:
+    // not copyable, owns the threads
+    WorkerPool(const WorkerPool& other);
+    WorkerPool& operator=(const WorkerPool& other);
+
+    /// thread main function
+    static void* threadMain(void* arg);
+
+    /// argument passed to each thread
+    struct ThreadArg {
+        WorkerPool*  pool;
+        unsigned int worker;
+    };
+
+    std::vector<pthread_t> threads;    ///< additional threads
+    std::vector<ThreadArg> threadArgs; ///< arguments of the additional threads
+    pthread_barrier_t      startBarrier; ///< passed by all workers when a job starts
+    pthread_barrier_t      endBarrier;   ///< passed by all workers when a job has finished
+    Job                    job;        ///< current job
+    void*                  context;    ///< context of the current job
+    bool                   stop;       ///< threads shall terminate
+};
+
+#endif // WORKER_POOL_H
@@ -0,0 +1,164 @@
+/*      audria-dump.cpp
+ *
+ *      converts audria's binary and compressed output formats back to CSV,
+ *      the output is identical to what audria would have written in CSV format
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ */
+
+#include "Output.h"
+#include "ProcReader.h"
+#include "TimeSpec.h"
+
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+
+#include <errno.h>
+
+/// reads a header following the magic bytes, either of the binary or, if @p compressed, of the compressed format,
+/// creates a CSV output for its columns and writes the CSV header
+/// @return false if the header is invalid
+bool readHeader(std::istream& in, const char* magic, const bool compressed, std::vector<int>& columns,
+                uint32_t& recordSize, CsvOutput*& csv) {
+    BinaryFormat::Header header;
+    memcpy(header.magic, magic, sizeof(header.magic));
+    in.read(reinterpret_cast<char*>(&header) + sizeof(header.magic), sizeof(header) - sizeof(header.magic));
+    const char* formatMagic = compressed ? CompressedFormat::magic : BinaryFormat::magic;
+    if (!in || memcmp(header.magic, formatMagic, sizeof(header.magic)) != 0) {
+        std::cerr << "not a " << (compressed ? "compressed" : "binary") << " audria file or truncated header" << std::endl;
+        return false;
+    }
+    if (header.version != (compressed ? CompressedFormat::version : BinaryFormat::version)) {
+        std::cerr << "unsupported version " << header.version << std::endl;
+        return false;
+    }
+
+    columns.clear();
+    std::set<int> fields;
+    for (uint32_t i = 0; i < header.columnCount; ++i) {
+        uint16_t id, type;
+        in.read(reinterpret_cast<char*>(&id),   sizeof(id));
+        in.read(reinterpret_cast<char*>(&type), sizeof(type));
+        if (!in || id >= StatusColumnCount || type != statusColumnType[id]) {
+            std::cerr << "invalid or unknown column in header" << std::endl;
+            return false;
+        }
+        columns.push_back(id);
+        fields.insert(id);
+    }
+
+    recordSize = header.recordSize;
+    if (columns.empty() || recordSize != (compressed ? 0 : BinaryFormat::recordSize(columns))) {
+        std::cerr << "invalid record size in header" << std::endl;
+        return false;
+    }
+
+    delete csv;
+    csv = new CsvOutput(std::cout, fields);
+    csv->writeHeader();
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 2 || (argc == 2 && std::string(argv[1]) == "-h")) {
+        std::cerr << "Usage: " << argv[0] << " [FILE]" << std::endl
+                  << "  converts audria's binary or compressed output from FILE (default: stdin) to CSV on stdout"
+                  << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    std::ifstream file;
+    if (argc == 2 && std::string(argv[1]) != "-") {
+        file.open(argv[1], std::ios::binary);
+        if (!file) {
+            std::cerr << "could not open file '" << argv[1] << "': " << strerror(errno) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    std::istream& in = file.is_open() ? file : std::cin;
+
+    std::vector<int> columns;
+    uint32_t recordSize = 0;
+    CsvOutput* csv = NULL;
+    std::vector<char> record;
+    TimeSpec ts;
+    ProcessStatus status = ProcessStatus();
+
+    // the first header decides the format
+    char magic[sizeof(BinaryFormat::magic)];
+    if (!in.read(magic, sizeof(magic))) {
+        return 0;
+    }
+    if (memcmp(magic, CompressedFormat::magic, sizeof(magic)) == 0) {
+        CompressedDecoder* decoder = NULL;
+        bool header = true;
+        while (true) {
+            if (header) {
+                if (!readHeader(in, magic, true, columns, recordSize, csv)) {
+                    exit(EXIT_FAILURE);
+                }
+                delete decoder;
+                decoder = new CompressedDecoder(columns);
+            }
+
+            // the tag byte of each record has its highest bit set, unlike the first magic byte of a header
+            const int next = in.peek();
+            if (next == std::istream::traits_type::eof()) break;
+            header = next == CompressedFormat::magic[0];
+            if (header) {
+                in.read(magic, sizeof(magic));
+                continue;
+            }
+
+            if (!decoder->decode(in, ts, status)) {
+                std::cerr << "invalid record or truncated record at end of file" << std::endl;
+                break;
+            }
+            csv->writeRow(ts, status);
+        }
+        delete decoder;
+        delete csv;
+        return 0;
+    }
+
+    // each record starts with its timestamp, which can never equal the magic bytes of a further header
+    do {
+        if (memcmp(magic, BinaryFormat::magic, sizeof(magic)) == 0) {
+            if (!readHeader(in, magic, false, columns, recordSize, csv)) {
+                exit(EXIT_FAILURE);
+            }
+            record.resize(recordSize);
+            continue;
+        }
+
+        if (!csv) {
+            std::cerr << "not a binary or compressed audria file" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        memcpy(&record[0], magic, sizeof(magic));
+        if (!in.read(&record[sizeof(magic)], recordSize - sizeof(magic))) {
+            std::cerr << "truncated record at end of file" << std::endl;
+            break;
+        }
+
+        BinaryFormat::decodeRecord(&record[0], columns, ts, status);
+        csv->writeRow(ts, status);
+    } while (in.read(magic, sizeof(magic)));
+
+    delete csv;
+    return 0;
+}
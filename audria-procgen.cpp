@@ -0,0 +1,189 @@
+/*      audria-procgen.cpp
+ *
+ *      creates a synthetic /proc tree for benchmarking, i.e. DIR/uptime and DIR/PID/{stat,status,io,schedstat}
+ *      for the given number of processes, following the format of a recent Linux kernel,
+ *      use audria's -p option to read from the generated tree
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ */
+
+#include "helper.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+// first PID to generate
+static const int firstPID = 1000;
+
+// process names, including some which are awkward to parse
+static const char* const names[] = {
+    "bash", "sshd", "systemd", "kworker/0:1-events", "Web Content", "(sd-pam)",
+    "python3", "postgres", "nginx", "a) b (c", "java", "containerd-shim"
+};
+static const unsigned int nameCount = sizeof(names) / sizeof(names[0]);
+
+/// returns a pseudo-random number in [0, max)
+unsigned long randomNumber(const unsigned long max) {
+    return (((unsigned long)rand() << 31) ^ (unsigned long)rand()) % max;
+}
+
+/// writes @p content to @p path, exits on errors
+void writeFile(const std::string& path, const std::string& content) {
+    std::ofstream file(path.c_str());
+    file << content;
+    if (!file) {
+        std::cerr << "could not write " << path << ": " << strerror(errno) << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+/// creates the files of a single process
+void generateProcess(const std::string& root, const int pid, const double uptimeSecs) {
+    const std::string dir = root + "/" + numberToString(pid);
+    if (mkdir(dir.c_str(), 0755) == -1 && errno != EEXIST) {
+        std::cerr << "could not create " << dir << ": " << strerror(errno) << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    const char* name            = names[pid % nameCount];
+    const int ppid              = pid > firstPID ? firstPID + randomNumber(pid - firstPID) : 1;
+    const unsigned long vmSize  = 4096 + randomNumber(4 * 1024 * 1024);
+    const unsigned long vmRSS   = vmSize / (2 + randomNumber(8));
+    const unsigned long threads = 1 + randomNumber(32);
+    const unsigned long start   = randomNumber((unsigned long)(uptimeSecs * 100));
+    const unsigned long utime   = randomNumber((unsigned long)(uptimeSecs * 100) - start + 1);
+    const unsigned long stime   = utime / (1 + randomNumber(4));
+    const unsigned long rchar   = randomNumber(1UL << 40);
+    const unsigned long wchar   = randomNumber(1UL << 36);
+    const char state            = "RSSSSSDI"[randomNumber(8)];
+
+    std::ostringstream stat;
+    stat << pid << " (" << name << ") " << state << " " << ppid << " " << pid << " " << pid << " 0 -1 4194560 "
+         << randomNumber(1000000) << " 0 " << randomNumber(100) << " 0 " << utime << " " << stime << " 0 0 20 0 "
+         << threads << " 0 " << start << " " << vmSize * 1024 << " " << vmRSS / 4 << " 18446744073709551615 "
+         << "94521380356096 94521381093009 140726513580240 0 0 0 65536 3686404 1266761467 0 0 0 17 "
+         << randomNumber(8) << " 0 0 " << randomNumber(1000) << " 0 0 94521381328560 94521381376228 "
+         << "94521382735872 140726513582853 140726513582863 140726513582863 140726513586158 0\n";
+    writeFile(dir + "/stat", stat.str());
+
+    std::ostringstream status;
+    status << "Name:\t" << name << "\n"
+           << "Umask:\t0022\n"
+           << "State:\t" << state << " (sleeping)\n"
+           << "Tgid:\t" << pid << "\n"
+           << "Ngid:\t0\n"
+           << "Pid:\t" << pid << "\n"
+           << "PPid:\t" << ppid << "\n"
+           << "TracerPid:\t0\n"
+           << "Uid:\t1000\t1000\t1000\t1000\n"
+           << "Gid:\t1000\t1000\t1000\t1000\n"
+           << "FDSize:\t256\n"
+           << "Groups:\t4 24 27 30 46 100 1000 \n"
+           << "NStgid:\t" << pid << "\n"
+           << "NSpid:\t" << pid << "\n"
+           << "NSpgid:\t" << pid << "\n"
+           << "NSsid:\t" << pid << "\n"
+           << "VmPeak:\t" << vmSize + randomNumber(65536) << " kB\n"
+           << "VmSize:\t" << vmSize << " kB\n"
+           << "VmLck:\t       0 kB\n"
+           << "VmPin:\t       0 kB\n"
+           << "VmHWM:\t" << vmRSS + randomNumber(4096) << " kB\n"
+           << "VmRSS:\t" << vmRSS << " kB\n"
+           << "RssAnon:\t" << vmRSS / 2 << " kB\n"
+           << "RssFile:\t" << vmRSS / 2 << " kB\n"
+           << "RssShmem:\t       0 kB\n"
+           << "VmData:\t" << vmSize / 2 << " kB\n"
+           << "VmStk:\t     132 kB\n"
+           << "VmExe:\t     720 kB\n"
+           << "VmLib:\t    2012 kB\n"
+           << "VmPTE:\t      56 kB\n"
+           << "VmSwap:\t" << randomNumber(1024) << " kB\n"
+           << "HugetlbPages:\t       0 kB\n"
+           << "CoreDumping:\t0\n"
+           << "THP_enabled:\t1\n"
+           << "Threads:\t" << threads << "\n"
+           << "SigQ:\t0/63344\n"
+           << "SigPnd:\t0000000000000000\n"
+           << "ShdPnd:\t0000000000000000\n"
+           << "SigBlk:\t0000000000010000\n"
+           << "SigIgn:\t0000000000380004\n"
+           << "SigCgt:\t000000004b817efb\n"
+           << "CapInh:\t0000000000000000\n"
+           << "CapPrm:\t0000000000000000\n"
+           << "CapEff:\t0000000000000000\n"
+           << "CapBnd:\t000001ffffffffff\n"
+           << "CapAmb:\t0000000000000000\n"
+           << "NoNewPrivs:\t0\n"
+           << "Seccomp:\t0\n"
+           << "Seccomp_filters:\t0\n"
+           << "Speculation_Store_Bypass:\tthread vulnerable\n"
+           << "SpeculationIndirectBranch:\tconditional enabled\n"
+           << "Cpus_allowed:\tff\n"
+           << "Cpus_allowed_list:\t0-7\n"
+           << "Mems_allowed:\t00000000,00000001\n"
+           << "Mems_allowed_list:\t0\n"
+           << "voluntary_ctxt_switches:\t" << randomNumber(100000) << "\n"
+           << "nonvoluntary_ctxt_switches:\t" << randomNumber(1000) << "\n";
+    writeFile(dir + "/status", status.str());
+
+    std::ostringstream io;
+    io << "rchar: " << rchar << "\n"
+       << "wchar: " << wchar << "\n"
+       << "syscr: " << rchar / 4096 << "\n"
+       << "syscw: " << wchar / 4096 << "\n"
+       << "read_bytes: " << rchar / 2 << "\n"
+       << "write_bytes: " << wchar / 2 << "\n"
+       << "cancelled_write_bytes: 0\n";
+    writeFile(dir + "/io", io.str());
+
+    std::ostringstream schedStat;
+    schedStat << (utime + stime) * 10000000 + randomNumber(10000000) << " "
+              << randomNumber(1000000000) << " " << randomNumber(100000) << "\n";
+    writeFile(dir + "/schedstat", schedStat.str());
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3 || atoi(argv[2]) <= 0) {
+        std::cerr << "Usage: " << argv[0] << " DIR NUM [SEED]" << std::endl
+                  << "  creates a synthetic /proc tree with NUM processes in DIR" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const std::string root(argv[1]);
+    const int count = atoi(argv[2]);
+    srand(argc > 3 ? atoi(argv[3]) : 1);
+
+    if (mkdir(root.c_str(), 0755) == -1 && errno != EEXIST) {
+        std::cerr << "could not create " << root << ": " << strerror(errno) << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const double uptimeSecs = 100000.0 + randomNumber(1000000);
+    std::ostringstream uptimeFile;
+    uptimeFile.setf(std::ios::fixed);
+    uptimeFile.precision(2);
+    uptimeFile << uptimeSecs << " " << uptimeSecs * 6 << "\n";
+    writeFile(root + "/uptime", uptimeFile.str());
+
+    for (int pid = firstPID; pid < firstPID + count; ++pid) {
+        generateProcess(root, pid, uptimeSecs);
+    }
+
+    return EXIT_SUCCESS;
+}
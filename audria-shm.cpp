@@ -0,0 +1,66 @@
+/*      audria-shm.cpp
+ *
+ *      example consumer of the shared memory segment audria publishes its rows to with -m,
+ *      writes the rows as CSV until audria terminates
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 3 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ */
+
+#include "Output.h"
+#include "ProcReader.h"
+#include "SharedRingReader.h"
+#include "TimeSpec.h"
+
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+#include <cstdlib>
+
+#include <time.h>
+
+int main(int argc, char* argv[]) {
+    if (argc != 2 || std::string(argv[1]) == "-h") {
+        std::cerr << "Usage: " << argv[0] << " NAME" << std::endl
+                  << "  writes the rows audria publishes to the shared memory segment NAME (see -m) as CSV to stdout" << std::endl
+                  << "  until audria terminates, starting with the oldest row still available" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    SharedRingReader reader;
+    if (!reader.open(argv[1])) {
+        exit(EXIT_FAILURE);
+    }
+
+    const std::vector<int>& columns = reader.getColumns();
+    CsvOutput csv(std::cout, std::set<int>(columns.begin(), columns.end()));
+    csv.writeHeader();
+
+    TimeSpec ts;
+    ProcessStatus status = ProcessStatus();
+    const struct timespec pollTS = {0, 10 * 1000 * 1000};
+    for (;;) {
+        // check before reading, rows written before closing the segment are still read
+        const bool closed = reader.isClosed();
+        while (reader.next(ts, status)) {
+            csv.writeRow(ts, status);
+        }
+        if (closed) break;
+
+        std::cout.flush();
+        nanosleep(&pollTS, NULL);
+    }
+
+    if (reader.getLost() != 0) {
+        std::cerr << reader.getLost() << " rows overwritten before they could be read" << std::endl;
+    }
+    return 0;
+}
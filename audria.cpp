@@ -30,18 +30,32 @@
  *   - syscalls?
  *   - per process net I/O (only works by capturing packets via pcap ;/)
  *   - check kernel version? needed when checking each file separately?
- *   - option to show userland threads?
  *
  */
 
 #include "audria.h"
 #include "helper.h"
 #include "definitions.h"
+#include "AsyncWriter.h"
+#include "ControlSocket.h"
+#include "Output.h"
 #include "ProcReader.h"
+#include "Recording.h"
 #include "ProcCache.h"
+#include "ProcEventListener.h"
+#include "ProcParser.h"
+#include "ProcessTrees.h"
+#include "SegmentWriter.h"
+#include "SelfStats.h"
+#include "SharedRingOutput.h"
+#include "TaskStatsReader.h"
+#include "TickScheduler.h"
 #include "TimeSpec.h"
+#include "WorkerPool.h"
 
+#include <algorithm>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <list>
 #include <map>
@@ -49,17 +63,39 @@
 #include <string>
 #include <vector>
 #include <cassert>
+#include <climits>
 #include <cmath>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
 
 #include <errno.h>
+#include <fcntl.h>
 #include <sched.h>
+#include <signal.h>
 #include <sys/resource.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
+// number of file descriptors not used for keeping files from /proc/pid/ open
+static const unsigned long reservedFiles = 32;
+
+// number of processes a thread claims at once when reading synchronously
+static const size_t samplingChunkSize = 16;
+
+// number of processes a thread claims at once when reading in batches via io_uring
+static const unsigned int uringBatchProcesses = 128;
+
+// maximum number of files read per process
+static const unsigned int filesPerProcess = FileKindCount;
+
+// interval in seconds for rescanning /proc when tracking processes via process events
+static const double processRescanSecs = 10.0;
+
+// default number of rows kept in the shared memory ring
+static const uint64_t defaultRingSlots = 16384;
+
 /// checks if all values in the current cache seem reasonable, just for debugging
 void checkCacheConsistency(const Cache& curCache, const Cache& oldCache) {
     if (oldCache.isEmpty) return;
@@ -75,6 +111,363 @@ void checkCacheConsistency(const Cache& curCache, const Cache& oldCache) {
     assert(curCache.totWrittenBytesStorage >= oldCache.totWrittenBytesStorage || curCache.totWrittenBytesStorage == 0);
     assert(curCache.totReadCalls >= oldCache.totReadCalls || curCache.totReadCalls == 0);
     assert(curCache.totWriteCalls >= oldCache.totWriteCalls || curCache.totWriteCalls == 0);
+    assert(curCache.cpuTimeNs >= oldCache.cpuTimeNs || curCache.cpuTimeNs == 0);
+    assert(curCache.runQueueWaitNs >= oldCache.runQueueWaitNs || curCache.runQueueWaitNs == 0);
+}
+
+/// removes @p processIt from @p processes, a terminated process keeps counting for its process tree
+void eraseProcess(ProcessMap& processes, ProcessMap::iterator processIt, ProcessTrees& trees) {
+    const Process& process = processIt->second;
+    if (!process.files.thread) {
+        trees.remove(process.tgid, process.status);
+    }
+    processes.erase(processIt);
+}
+
+/// updates the watched processes according to the given process events, terminated processes
+/// are only marked as exited so they can be read a last time, new processes are only added if @p addNew is set
+/// or if they belong to one of the @p trees
+void applyProcEvents(const ProcEventList& events, ProcessMap& processes, const bool addNew, ProcessTrees& trees) {
+    for (ProcEventList::const_iterator eventIt = events.begin(); eventIt != events.end(); ++eventIt) {
+        char pidStr[16];
+        snprintf(pidStr, sizeof(pidStr), "%d", eventIt->pid);
+        const std::string pid(pidStr);
+
+        ProcessMap::iterator processIt = processes.find(pid);
+        switch (eventIt->type) {
+            case ProcEvent::Fork:
+            case ProcEvent::Exec:
+                // PID may have been reused within a single iteration or after its files could not be read anymore
+                if (processIt != processes.end() && (processIt->second.exited || processIt->second.vanished)) {
+                    eraseProcess(processes, processIt, trees);
+                    processIt = processes.end();
+                }
+                if (eventIt->type == ProcEvent::Fork && trees.addChild(eventIt->pid, eventIt->ppid)) {
+                    processes.insert(std::make_pair(pid, Process(pid)));
+                } else if (addNew && processIt == processes.end()) {
+                    processes.insert(std::make_pair(pid, Process(pid)));
+                }
+                break;
+            case ProcEvent::Exit:
+                if (processIt != processes.end()) {
+                    processIt->second.exited = true;
+                }
+                break;
+        }
+    }
+}
+
+Sampler::Sampler(const std::set<int>& fields, const bool useTaskStats, const bool useUring, const bool showKThreads,
+                 const bool measure, const bool captureRaw, const bool schedStat) :
+  buffer(), taskStats(), uring(), plan(), threadPlan(), tickPlan(), tickThreadPlan(), monitorKThreads(showKThreads), collectStats(measure), stats(),
+  capture(captureRaw), recording(), uptimeSecs(0.0), due(), batchReads() {
+    if (useTaskStats) {
+        taskStats.open();
+    }
+    if (useUring) {
+        uring.open(uringBatchProcesses * filesPerProcess);
+    }
+    setFields(fields, schedStat);
+}
+
+void Sampler::setFields(const std::set<int>& fields, const bool schedStat) {
+    // only read and calculate what we are going to show, a recording has to contain all files
+    plan = ReadPlan(capture ? std::set<int>() : fields, taskStats.isOpen() ? &taskStats : NULL, schedStat);
+    if (capture) {
+        plan.readSchedStat = true;
+    }
+    threadPlan = plan;
+    threadPlan.readStatus = false;
+    tickPlan       = plan;
+    tickThreadPlan = threadPlan;
+    std::fill(due, due + FileKindCount, true);
+}
+
+void Sampler::setDue(const bool* tickDue) {
+    tickPlan       = plan.restrictTo(tickDue);
+    tickThreadPlan = threadPlan.restrictTo(tickDue);
+    std::copy(tickDue, tickDue + FileKindCount, due);
+}
+
+void Sampler::sample(Process& process) {
+    // none of the files required are due in this iteration
+    if (!planFor(process).readsAny()) {
+        return;
+    }
+
+    TimeSpec curTS;
+    clock_gettime(clockSource, &curTS.ts);
+
+    if (capture) {
+        captureProcess(process, NULL, false, curTS);
+        return;
+    }
+
+    ProcReader pr(process.files, buffer, planFor(process));
+    if (likely(!collectStats)) {
+        pr.readAll();
+    } else {
+        readAllTimed(process, pr);
+    }
+
+    finish(process, pr, curTS);
+}
+
+void Sampler::readAllTimed(Process& process, ProcReader& pr) {
+    const ReadPlan& taskPlan = planFor(process);
+    uint64_t readNs  = 0;
+    uint64_t parseNs = 0;
+
+    // same order as ProcReader::readAll()
+    if (taskPlan.readStat) {
+        readFile(process.files.stat, -1, false, pr, &ProcReader::parseProcessStat, readNs, parseNs);
+    }
+    if (taskPlan.taskStats) {
+        // taskstats replies are parsed while receiving them, count all as reading
+        const uint64_t startNs = nowNsecs();
+        pr.readTaskStats();
+        readNs += nowNsecs() - startNs;
+    }
+    if (taskPlan.readStatus) {
+        readFile(process.files.status, -1, false, pr, &ProcReader::parseProcessStatus, readNs, parseNs);
+    }
+    if (taskPlan.readIO) {
+        readFile(process.files.io, -1, false, pr, &ProcReader::parseProcessIO, readNs, parseNs);
+    }
+    if (taskPlan.readSchedStat) {
+        readFile(process.files.schedStat, -1, false, pr, &ProcReader::parseProcessSchedStat, readNs, parseNs);
+    }
+
+    stats.read.add(readNs);
+    stats.parse.add(parseNs);
+}
+
+void Sampler::sampleBatch(Process* const* processes, const size_t count) {
+    if (!uring.isOpen()) {
+        for (size_t i = 0; i < count; ++i) {
+            sample(*processes[i]);
+        }
+        return;
+    }
+
+    assert(count <= batchSize());
+    batchReads.resize(count * filesPerProcess);
+
+    // queue reads of all files of all processes
+    for (size_t i = 0; i < count; ++i) {
+        ProcFiles& files = processes[i]->files;
+        const ReadPlan& taskPlan = planFor(*processes[i]);
+        batchReads[i * filesPerProcess + 0] = taskPlan.readStat   ? queueRead(files.stat)   : -1;
+        batchReads[i * filesPerProcess + 1] = taskPlan.readStatus ? queueRead(files.status) : -1;
+        batchReads[i * filesPerProcess + 2] = taskPlan.readIO     ? queueRead(files.io)     : -1;
+        batchReads[i * filesPerProcess + 3] = taskPlan.readSchedStat ? queueRead(files.schedStat) : -1;
+    }
+
+    // all files of the batch are read at the same time
+    TimeSpec curTS;
+    clock_gettime(clockSource, &curTS.ts);
+    const uint64_t submitStartNs = timestamp();
+    const bool submitted = uring.submit();
+    // all files of the batch are read at once, attribute an equal share to each process
+    const uint64_t submitNs = (timestamp() - submitStartNs) / count;
+
+    // parse in the same order as ProcReader::readAll()
+    for (size_t i = 0; i < count; ++i) {
+        Process& process = *processes[i];
+        if (!planFor(process).readsAny()) {
+            continue;
+        }
+        if (capture) {
+            captureProcess(process, &batchReads[i * filesPerProcess], submitted, curTS);
+            continue;
+        }
+
+        const ReadPlan& taskPlan = planFor(process);
+        ProcReader pr(process.files, buffer, taskPlan);
+        uint64_t readNs  = submitNs;
+        uint64_t parseNs = 0;
+
+        if (taskPlan.readStat) {
+            readFile(process.files.stat, batchReads[i * filesPerProcess + 0], submitted, pr,
+                     &ProcReader::parseProcessStat, readNs, parseNs);
+        }
+        if (taskPlan.taskStats) {
+            const uint64_t startNs = timestamp();
+            pr.readTaskStats();
+            readNs += timestamp() - startNs;
+        }
+        if (taskPlan.readStatus) {
+            readFile(process.files.status, batchReads[i * filesPerProcess + 1], submitted, pr,
+                     &ProcReader::parseProcessStatus, readNs, parseNs);
+        }
+        if (taskPlan.readIO) {
+            readFile(process.files.io, batchReads[i * filesPerProcess + 2], submitted, pr,
+                     &ProcReader::parseProcessIO, readNs, parseNs);
+        }
+        if (taskPlan.readSchedStat) {
+            readFile(process.files.schedStat, batchReads[i * filesPerProcess + 3], submitted, pr,
+                     &ProcReader::parseProcessSchedStat, readNs, parseNs);
+        }
+
+        if (collectStats) {
+            stats.read.add(readNs);
+            stats.parse.add(parseNs);
+        }
+        finish(process, pr, curTS);
+    }
+}
+
+size_t Sampler::batchSize() const {
+    return uring.isOpen() ? uring.capacity() / filesPerProcess : samplingChunkSize;
+}
+
+int Sampler::queueRead(ProcFile& file) {
+    const int fd = file.descriptor();
+    return fd == -1 ? -1 : (int)uring.add(fd);
+}
+
+void Sampler::replay(Process& process, const TimeSpec& ts, const std::string* const* contents, const bool* recorded) {
+    const ReadPlan& taskPlan = planFor(process);
+    const bool planned[FileKindCount] = {
+        taskPlan.readStat, taskPlan.readStatus, taskPlan.readIO, taskPlan.readSchedStat
+    };
+    const ParseFunction parse[FileKindCount] = {
+        &ProcReader::parseProcessStat, &ProcReader::parseProcessStatus, &ProcReader::parseProcessIO,
+        &ProcReader::parseProcessSchedStat
+    };
+
+    ProcReader pr(process.files, buffer, taskPlan);
+    for (int kind = 0; kind < FileKindCount; ++kind) {
+        if (!planned[kind] || !recorded[kind]) continue;
+        if (contents[kind]) {
+            (pr.*parse[kind])(contents[kind]->c_str(), contents[kind]->size());
+        } else {
+            (pr.*parse[kind])(NULL, -1);
+        }
+    }
+
+    finish(process, pr, ts);
+}
+
+void Sampler::captureProcess(Process& process, const int* reads, const bool submitted, const TimeSpec& curTS) {
+    ProcFile* const files[FileKindCount] = {
+        &process.files.stat, &process.files.status, &process.files.io, &process.files.schedStat
+    };
+    const ReadPlan& taskPlan = planFor(process);
+    const bool planned[FileKindCount] = {
+        taskPlan.readStat, taskPlan.readStatus, taskPlan.readIO, taskPlan.readSchedStat
+    };
+
+    Recording::appendProcess(recording, process.tgid, process.files.thread ? process.files.pid : 0, curTS);
+    for (int kind = 0; kind < FileKindCount; ++kind) {
+        if (!planned[kind]) continue;
+        const char* data;
+        ssize_t len;
+        batchResult(*files[kind], reads ? reads[kind] : -1, submitted, data, len);
+        Recording::appendFile(recording, (ProcFileKind)kind, data, len, process.captured[kind]);
+
+        // the number of threads is required for keeping track of them, see updateThreads()
+        if (kind == FileStat) {
+            process.status   = ProcessStatus();
+            process.sampled  = len > 0 && ProcParser::parseStat(data, len, process.status);
+            process.vanished = len < 0;
+        }
+    }
+}
+
+void Sampler::readFile(ProcFile& file, const int read, const bool submitted, ProcReader& pr, ParseFunction parse,
+                       uint64_t& readNs, uint64_t& parseNs) {
+    const uint64_t startNs = timestamp();
+    const char* data;
+    ssize_t len;
+    batchResult(file, read, submitted, data, len);
+
+    const uint64_t parseStartNs = timestamp();
+    (pr.*parse)(data, len);
+    parseNs += timestamp() - parseStartNs;
+    readNs  += parseStartNs - startNs;
+}
+
+void Sampler::batchResult(ProcFile& file, const int read, const bool submitted, const char*& data, ssize_t& len) {
+    if (read != -1 && submitted) {
+        len = uring.result(read);
+        // fall back to a synchronous read if the file may have been truncated or reading has failed,
+        // the latter also handles terminated processes and kernels not supporting the read opcode
+        if (likely(len > 0 && (size_t)len < UringReader::slotSize - 1)) {
+            data = uring.data(read);
+            return;
+        }
+    }
+
+    len = file.read(buffer);
+    data = &buffer[0];
+}
+
+void Sampler::finish(Process& process, ProcReader& pr, const TimeSpec& curTS) {
+    // skip processes terminated in the meantime and kernel threads if not requested
+    if (unlikely(!pr.hasReadAny())) {
+        process.vanished = true;
+        return;
+    }
+
+    // files which are not due in this iteration keep their last values
+    pr.carryOver(process.status, due);
+
+    if (!monitorKThreads && pr.isKernelThread()) {
+        return;
+    }
+
+    double elapsedSecs[FileKindCount];
+    for (int kind = 0; kind < FileKindCount; ++kind) {
+        elapsedSecs[kind] = process.readTS[kind] == TimeSpec() ? 0.0 : (curTS - process.readTS[kind]).seconds();
+        if (pr.hasReadFile((ProcFileKind)kind)) {
+            process.readTS[kind] = curTS;
+        }
+    }
+
+    pr.updateCache();
+
+    pr.calcAll(process.oldStatusCache, elapsedSecs, uptimeSecs);
+
+    const Cache& curCache = pr.getCache();
+    checkCacheConsistency(curCache, process.oldStatusCache);
+
+    process.status         = pr.getProcessStatus();
+    if (process.files.thread) {
+        // /proc/pid/task/tid/stat and taskstats report the TID instead
+        process.status.setInteger(PID, process.tgid);
+    }
+    if (!(process.oldStatusTS == TimeSpec())) {
+        // the effective interval of this process, which differs from -d when iterations are late or staggered
+        process.status.setReal(IntervalSecs, (curTS - process.oldStatusTS).seconds());
+    }
+    process.oldStatusCache = curCache;
+    process.oldStatusTS    = curTS;
+    process.sampled        = true;
+}
+
+/// processes to read in the current iteration, shared by all sampling threads
+struct SamplingJob {
+    SamplingJob() : processes(), samplers(), next(0) {}
+
+    std::vector<Process*> processes; ///< processes to read
+    std::vector<Sampler*> samplers;  ///< one sampler per thread
+    size_t                next;      ///< index of the next process to read, claimed atomically
+};
+
+/// reads processes from a @ref SamplingJob until all have been read, called by each sampling thread
+void sampleProcesses(void* context, const unsigned int worker) {
+    SamplingJob& job = *static_cast<SamplingJob*>(context);
+    Sampler& sampler = *job.samplers[worker];
+
+    const size_t chunkSize = sampler.batchSize();
+    for (;;) {
+        const size_t first = __sync_fetch_and_add(&job.next, chunkSize);
+        if (first >= job.processes.size())
+            break;
+        const size_t last = std::min(first + chunkSize, job.processes.size());
+        sampler.sampleBatch(&job.processes[first], last - first);
+    }
 }
 
 /// parses status column fields from a string and returns the corresponding internal IDs as a set
@@ -101,21 +494,712 @@ std::set<int> parseFieldsFromString(const std::string& str) {
     return fields;
 }
 
+/// returns the key of a single thread of a process in a @ref ProcessMap, i.e. its path below /proc,
+/// threads directly follow their process as '/' sorts before all digits
+std::string threadKey(const std::string& pid, const std::string& tid) {
+    return pid + "/task/" + tid;
+}
+
+/// keeps the threads of all processes sampled in the current iteration in @p processes up to date,
+/// /proc/pid/task/ is only listed again if the number of threads differs from the threads we know,
+/// which also covers threads that could not be read anymore
+void updateThreads(ProcessMap& processes) {
+    for (ProcessMap::iterator processIt = processes.begin(); processIt != processes.end(); ) {
+        Process& process = processIt->second;
+        if (process.files.thread) {
+            // thread of a process which is not watched anymore
+            if (process.vanished) {
+                processes.erase(processIt++);
+            } else {
+                ++processIt;
+            }
+            continue;
+        }
+
+        // forget threads which could not be read anymore
+        const std::string prefix = threadKey(processIt->first, "");
+        ProcessMap::iterator threadIt = processIt;
+        int64_t threads = 0;
+        for (++threadIt; threadIt != processes.end() && threadIt->first.compare(0, prefix.size(), prefix) == 0; ) {
+            if (threadIt->second.vanished) {
+                processes.erase(threadIt++);
+            } else {
+                ++threadIt;
+                ++threads;
+            }
+        }
+
+        // the number of threads is taken from /proc/pid/stat, without it we have to list them every time
+        const bool changed = !process.status.isValid(Threads) || process.status.values[Threads].i != threads;
+        if (process.sampled && changed) {
+            const PIDSet& tidSet = ProcReader::tids(processIt->first);
+
+            ProcessMap::iterator knownIt = processIt;
+            for (++knownIt; knownIt != threadIt; ) {
+                if (tidSet.count(knownIt->first.substr(prefix.size())) == 0) {
+                    processes.erase(knownIt++);
+                } else {
+                    ++knownIt;
+                }
+            }
+            for (PIDSet::const_iterator tidIt = tidSet.begin(); tidIt != tidSet.end(); ++tidIt) {
+                const std::string& key = threadKey(processIt->first, *tidIt);
+                if (processes.count(key) == 0) {
+                    processes.insert(std::make_pair(key, Process(key)));
+                }
+            }
+        }
+
+        // new threads have been inserted before the next process
+        processIt = threadIt;
+    }
+}
+
+/// processes to write in each iteration
+struct TopRows {
+    TopRows() : count(0), column(CurCPUPerc) {}
+
+    size_t count;  ///< number of processes to write, 0 for all
+    int    column; ///< column to rank processes by
+};
+
+/// orders processes by descending value of a column, processes without a value come last
+/// @note NaN, e.g. UserTimePerc of a process without any CPU time, counts as no value to keep a strict weak ordering
+struct RankByColumn {
+    RankByColumn(const int rankColumn) : column(rankColumn) {}
+
+    bool operator()(const Process* left, const Process* right) const {
+        const ProcessStatus& a = left->status;
+        const ProcessStatus& b = right->status;
+        if (hasValue(a) != hasValue(b)) return hasValue(a);
+        if (!hasValue(a)) return false;
+
+        switch (statusColumnType[column]) {
+            case ColumnCounter:
+                return a.values[column].u > b.values[column].u;
+            case ColumnReal:
+                return a.values[column].d > b.values[column].d;
+            default:
+                return a.values[column].i > b.values[column].i;
+        }
+    }
+
+    /// returns whether @p status holds a value to rank by
+    bool hasValue(const ProcessStatus& status) const {
+        return status.isValid(column) && !(statusColumnType[column] == ColumnReal && std::isnan(status.values[column].d));
+    }
+
+    int column; ///< column to compare
+};
+
+/// writes the rows of @p rows in their order, or only of the @p top ones in descending order, and clears @p rows,
+/// only rows passing @p changeFilter are written unless it is NULL, only rows written are formatted
+void writeRows(std::vector<Process*>& rows, const TopRows& top, Output& output, const ChangeFilter* changeFilter) {
+    size_t count = rows.size();
+    if (top.count > 0) {
+        count = std::min(top.count, rows.size());
+        std::partial_sort(rows.begin(), rows.begin() + count, rows.end(), RankByColumn(top.column));
+    }
+
+    for (size_t row = 0; row < count; ++row) {
+        Process& process = *rows[row];
+        if (!changeFilter ||
+            changeFilter->pass(process.oldStatusTS, process.status, process.lastRow, process.lastRowTS)) {
+            output.writeRow(process.oldStatusTS, process.status);
+        }
+    }
+    rows.clear();
+}
+
+/// creates the output in the requested format, which also publishes all rows to the shared memory ring
+/// @p ringName with @p ringSlots slots unless @p ringName is NULL
+/// @return NULL if the ring could not be created, an error message has been printed then
+Output* createOutput(const OutputFormat format, std::ostream& log, const std::set<int>& fields,
+                     const char* ringName, const uint64_t ringSlots) {
+    Output* output = NULL;
+    switch (format) {
+        case FormatBinary:
+            output = new BinaryOutput(log, fields);
+            break;
+        case FormatCompressed:
+            output = new CompressedOutput(log, fields);
+            break;
+        default:
+            output = new CsvOutput(log, fields);
+            break;
+    }
+    if (!ringName) {
+        return output;
+    }
+
+    SharedRingOutput* ring = new SharedRingOutput(output, log, fields);
+    if (!ring->open(ringName, ringSlots)) {
+        delete ring;
+        return NULL;
+    }
+    return ring;
+}
+
+/// replays a recording made with -C, calculates and writes the status of all recorded processes,
+/// the rows written are chosen like in a live run, see @ref writeRows()
+/// @return false if the recording is invalid
+bool replayRecording(std::istream& in, Sampler& sampler, Output& output, const TopRows& top,
+                     const ChangeFilter* changeFilter, std::ostream& log) {
+    RecordingReader reader(in);
+    RecordingReader::Record record;
+    ProcessMap processes;
+    std::set<std::string> recordedPIDs; // processes recorded in the current iteration
+    std::vector<Process*> rows;         // processes to write in the current iteration
+    bool checkedHertz = false;
+
+    // files of the current process, replayed once all of them have been read
+    Process* process = NULL;
+    TimeSpec processTS;
+    const std::string* contents[FileKindCount];
+    bool recorded[FileKindCount];
+
+    for (;;) {
+        const bool haveRecord = reader.next(record);
+        if (haveRecord && (record.type == Recording::RecordFile || record.type == Recording::RecordFileFailed)) {
+            if (!process) {
+                std::cerr << "file without process in recording" << std::endl;
+                return false;
+            }
+            contents[record.kind] = record.content;
+            recorded[record.kind] = true;
+            continue;
+        }
+
+        // a process record is complete as soon as the next record starts
+        if (process) {
+            sampler.replay(*process, processTS, contents, recorded);
+            process = NULL;
+        }
+
+        if (!haveRecord || record.type == Recording::RecordTick) {
+            // an iteration is complete, print in order of the PIDs like a live run
+            for (ProcessMap::iterator processIt = processes.begin(); processIt != processes.end(); ++processIt) {
+                if (processIt->second.sampled) {
+                    processIt->second.sampled = false;
+                    rows.push_back(&processIt->second);
+                }
+            }
+            writeRows(rows, top, output, changeFilter);
+
+            // forget processes which have not been recorded anymore
+            for (ProcessMap::iterator processIt = processes.begin(); processIt != processes.end(); ) {
+                if (recordedPIDs.count(processIt->first) == 0) {
+                    processes.erase(processIt++);
+                } else {
+                    ++processIt;
+                }
+            }
+            log.flush();
+            recordedPIDs.clear();
+
+            if (!haveRecord) break;
+
+            if (!checkedHertz && reader.getHertz() != (uint32_t)getHertz()) {
+                std::cerr << "warning: recording was made with " << reader.getHertz() << " clock ticks per second, "
+                          << "this system has " << getHertz() << ", expect bogus values" << std::endl;
+            }
+            checkedHertz = true;
+            sampler.setUptime(record.uptimeSecs);
+        } else if (record.type == Recording::RecordProcess) {
+            const std::string pid = record.tid != 0 ? threadKey(numberToString(record.pid), numberToString(record.tid))
+                                                    : numberToString(record.pid);
+            process = &processes.insert(std::make_pair(pid, Process(pid))).first->second;
+            recordedPIDs.insert(pid);
+            processTS = record.ts;
+            for (int kind = 0; kind < FileKindCount; ++kind) {
+                contents[kind] = NULL;
+                recorded[kind] = false;
+            }
+        }
+    }
+
+    return !reader.hasFailed();
+}
+
+/// parses the writer policy from a string like "flush=tick,full=drop,size=1048576"
+/// @return false on errors
+bool parseWriterPolicy(const std::string& str, WriterPolicy& policy) {
+    std::stringstream sstream(str);
+    std::string option;
+    while (std::getline(sstream, option, ',')) {
+        const size_t sep = option.find('=');
+        if (sep == std::string::npos) return false;
+        const std::string key   = option.substr(0, sep);
+        const std::string value = option.substr(sep + 1);
+
+        if (key == "flush") {
+            if (value == "tick") {
+                policy.flush = WriterPolicy::FlushTick;
+            } else if (value.compare(0, 6, "bytes:") == 0 && isNumber(value.substr(6))) {
+                policy.flush      = WriterPolicy::FlushBytes;
+                policy.flushBytes = stringToNumber<size_t>(value.substr(6));
+            } else if (value.compare(0, 5, "time:") == 0 && isNumber(value.substr(5))) {
+                policy.flush     = WriterPolicy::FlushTime;
+                policy.flushSecs = stringToNumber<double>(value.substr(5));
+                if (policy.flushSecs <= 0.0) return false;
+            } else {
+                return false;
+            }
+        } else if (key == "full") {
+            if (value == "block") {
+                policy.overflow = WriterPolicy::OverflowBlock;
+            } else if (value == "drop") {
+                policy.overflow = WriterPolicy::OverflowDrop;
+            } else if (value == "count") {
+                policy.overflow = WriterPolicy::OverflowCount;
+            } else {
+                return false;
+            }
+        } else if (key == "size" && isNumber(value)) {
+            policy.capacity = stringToNumber<size_t>(value);
+            if (policy.capacity == 0) return false;
+        } else {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/// parses the change policy from a string like "heartbeat=10,cpu=5,io=4096"
+/// @return false on errors
+bool parseChangePolicy(const std::string& str, ChangePolicy& policy) {
+    std::stringstream sstream(str);
+    std::string option;
+    while (std::getline(sstream, option, ',')) {
+        const size_t sep = option.find('=');
+        if (sep == std::string::npos) return false;
+        const std::string key   = option.substr(0, sep);
+        const std::string value = option.substr(sep + 1);
+        if (!isNumber(value) || stringToNumber<double>(value) < 0.0) return false;
+
+        if (key == "heartbeat") {
+            policy.heartbeatSecs = stringToNumber<double>(value);
+        } else if (key == "cpu") {
+            policy.cpuPerc = stringToNumber<double>(value);
+        } else if (key == "io") {
+            policy.ioBytesPerSec = stringToNumber<double>(value);
+        } else {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/// parses the segment policy from a string like "size=67108864,age=3600,keep=24"
+/// @return false on errors
+bool parseSegmentPolicy(const std::string& str, SegmentPolicy& policy) {
+    std::stringstream sstream(str);
+    std::string option;
+    while (std::getline(sstream, option, ',')) {
+        const size_t sep = option.find('=');
+        if (sep == std::string::npos) return false;
+        const std::string key   = option.substr(0, sep);
+        const std::string value = option.substr(sep + 1);
+        if (!isNumber(value) || stringToNumber<double>(value) < 0.0) return false;
+
+        if (key == "size") {
+            policy.segmentBytes = stringToNumber<size_t>(value);
+            if (policy.segmentBytes == 0) return false;
+        } else if (key == "age") {
+            policy.maxAgeSecs = stringToNumber<double>(value);
+        } else if (key == "keep") {
+            policy.keep = stringToNumber<unsigned int>(value);
+        } else {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/// parses the number of processes to write and the column to rank them by from a string like "10,VmRsskB"
+/// @return false on errors
+bool parseTopRows(const std::string& str, TopRows& top) {
+    const size_t sep = str.find(',');
+    const std::string count = str.substr(0, sep);
+    if (!isNumber(count) || stringToNumber<int>(count) < 1) return false;
+    top.count = stringToNumber<int>(count);
+    if (sep == std::string::npos) return true;
+
+    const std::set<int>& fields = parseFieldsFromString(str.substr(sep + 1));
+    if (fields.size() != 1 || statusColumnType[*fields.begin()] == ColumnText) return false;
+    top.column = *fields.begin();
+    return true;
+}
+
+/// parses the name of a shared memory segment and optionally its number of slots from a string like "audria,65536"
+/// @return false on errors
+bool parseSharedRing(const std::string& str, std::string& name, uint64_t& slots) {
+    const size_t sep = str.find(',');
+    name = str.substr(0, sep);
+    // a single leading slash is allowed, see shm_open()
+    if (name.empty() || name == "/" || name.find('/', 1) != std::string::npos) return false;
+    if (sep == std::string::npos) return true;
+
+    const std::string count = str.substr(sep + 1);
+    if (!isNumber(count) || stringToNumber<uint64_t>(count) < 1) return false;
+    slots = stringToNumber<uint64_t>(count);
+    return true;
+}
+
+/// parses the periods of file groups from a string like "io=0.1,status=1" into multiples of @p delaySecs,
+/// stored in @p every indexed by @ref ProcFileKind
+/// @return false on errors
+bool parseFileGroups(const std::string& str, const double delaySecs, unsigned int* every) {
+    static const char* const fileNames[FileKindCount] = { "stat", "status", "io", "schedstat" };
+
+    std::stringstream sstream(str);
+    std::string group;
+    while (std::getline(sstream, group, ',')) {
+        const size_t sep = group.find('=');
+        if (sep == std::string::npos) return false;
+        const std::string key   = group.substr(0, sep);
+        const std::string value = group.substr(sep + 1);
+        if (!isNumber(value)) return false;
+        const double periodSecs = stringToNumber<double>(value);
+        if (periodSecs <= 0.0) return false;
+
+        int kind = 0;
+        while (kind < FileKindCount && key != fileNames[kind]) {
+            ++kind;
+        }
+        if (kind == FileKindCount) return false;
+
+        // periods are rounded to multiples of the interval
+        every[kind] = std::max(1L, lround(periodSecs / delaySecs));
+    }
+
+    return true;
+}
+
+/// returns the greatest common divisor of @p a and @p b
+unsigned int greatestCommonDivisor(unsigned int a, unsigned int b) {
+    while (b != 0) {
+        const unsigned int rest = a % b;
+        a = b;
+        b = rest;
+    }
+    return a;
+}
+
+/// set by the signal handler when we shall terminate
+static volatile sig_atomic_t terminateRequested = 0;
+
+/// signal handler requesting a clean shutdown
+void requestTermination(int) {
+    terminateRequested = 1;
+}
+
+/// state of a live run which clients of the control socket can query and change, see @ref handleControlRequest()
+struct LiveRun {
+    LiveRun() :
+      processes(NULL), trees(NULL), samplers(NULL), scheduler(NULL), control(NULL), log(NULL), output(NULL),
+      controlOutput(NULL), changeFilter(NULL), fields(), delaySecs(0.0), outputFormat(FormatCsv), ringName(), ringSlots(0),
+      changesOnly(false), changePolicy(), top(), schedStatCPU(false), processTrees(false), monitorAll(false),
+      fixedFields(false), fixedInterval(false) {}
+
+    ProcessMap*            processes;     ///< watched processes
+    ProcessTrees*          trees;         ///< process trees, if requested
+    std::vector<Sampler*>* samplers;      ///< one sampler per thread
+    TickScheduler*         scheduler;     ///< schedules the iterations
+    ControlSocket*         control;       ///< socket of the clients
+    std::ostream*          log;           ///< stream the output is written to
+    Output*                output;        ///< output of all rows, NULL while recording with -C
+    ControlOutput*         controlOutput; ///< outermost part of @ref output if the socket is open, collects rows for subscribers
+    const ChangeFilter*    changeFilter;  ///< filter of unchanged rows, NULL if all rows are written
+    std::set<int>          fields;        ///< columns written, all if empty
+    double                 delaySecs;     ///< interval in seconds
+    OutputFormat           outputFormat;  ///< format rows are written in
+    std::string            ringName;      ///< shared memory ring rows are also published to, empty if none
+    uint64_t               ringSlots;     ///< number of slots of the shared memory ring
+    bool                   changesOnly;   ///< whether only rows of changed processes are written
+    ChangePolicy           changePolicy;  ///< when rows of changed processes are written
+    TopRows                top;           ///< which processes are written
+    bool                   schedStatCPU;  ///< whether CPU usage is calculated from schedstat
+    bool                   processTrees;  ///< whether added PIDs are the roots of process trees
+    bool                   monitorAll;    ///< whether all processes are watched, which cannot be removed then
+    bool                   fixedFields;   ///< whether the fields cannot be changed, i.e. while recording
+    bool                   fixedInterval; ///< whether the interval cannot be changed, i.e. with file groups
+
+  private:
+    // not copyable, refers to the state of main()
+    LiveRun(const LiveRun& other);
+    LiveRun& operator=(const LiveRun& other);
+};
+
+/// (re)creates the output of a live run, see @ref createOutput(), which also collects the rows for subscribers
+/// if the control socket is open
+/// @return false if the output could not be created, an error message has been printed then
+bool createLiveOutput(LiveRun& run) {
+    Output* output = createOutput(run.outputFormat, *run.log, run.fields, run.ringName.empty() ? NULL : run.ringName.c_str(),
+                                  run.ringSlots);
+    if (!output) {
+        run.output        = NULL;
+        run.controlOutput = NULL;
+        return false;
+    }
+
+    run.controlOutput = run.control->isOpen() ? new ControlOutput(output, *run.log, run.fields, *run.control) : NULL;
+    run.output        = run.controlOutput ? run.controlOutput : output;
+    return true;
+}
+
+/// parses a PID sent by a client of the control socket
+/// @return false if @p str is not a valid PID
+bool parsePID(const std::string& str, int& pid) {
+    // PIDs are the keys of the watched processes, so only accept their canonical form
+    if (str.empty() || str[0] == '0' || str.find_first_not_of("0123456789") != std::string::npos) return false;
+    const long value = strtol(str.c_str(), NULL, 10);
+    if (value > INT_MAX) return false;
+    pid = value;
+    return true;
+}
+
+/// answers a request of a client of the control socket, one of
+/// - get [PID]:       the latest row of the process and its threads, of all watched processes without PID
+/// - subscribe:       the CSV header followed by the rows written in each iteration
+/// - add PID:         watches another process, which is the root of a process tree with -P
+/// - remove PID:      stops watching a process and its threads
+/// - fields FIELDS:   changes the fields written, 'all' for all fields, processes keep their previous status
+///                    so rates continue right away, a new header is written to the output and to subscribers
+/// - interval SECS:   changes the delay between iterations
+/// each reply starts with a line 'ok' or 'error: message', followed by the data requested and an empty line
+void handleControlRequest(LiveRun& run, const ControlSocket::Request& request) {
+    std::istringstream words(request.line);
+    std::string command, argument, surplus;
+    words >> command >> argument >> surplus;
+
+    ProcessMap& processes = *run.processes;
+    std::ostringstream data;
+    std::string error;
+    int pid = 0;
+    if (!surplus.empty()) {
+        error = "too many arguments";
+    } else if (command == "get") {
+        if (!argument.empty() && !parsePID(argument, pid)) {
+            error = "invalid PID '" + argument + "'";
+        } else {
+            CsvOutput csv(data, run.fields);
+            csv.writeHeader();
+            bool found = false;
+            for (ProcessMap::const_iterator processIt = processes.begin(); processIt != processes.end(); ++processIt) {
+                const Process& process = processIt->second;
+                if ((pid != 0 && process.tgid != pid) || process.oldStatusTS == TimeSpec() || process.vanished) continue;
+                csv.writeRow(process.oldStatusTS, process.status);
+                found = true;
+            }
+            if (pid != 0 && !found) {
+                error = "PID " + argument + " not watched or not read yet";
+            }
+        }
+    } else if (command == "subscribe") {
+        if (!argument.empty()) {
+            error = "too many arguments";
+        } else if (!run.controlOutput) {
+            error = "no rows are written with -C";
+        } else {
+            run.control->subscribe(request.client);
+            data << run.controlOutput->header();
+        }
+    } else if (command == "add") {
+        if (!parsePID(argument, pid)) {
+            error = "invalid PID '" + argument + "'";
+        } else if (processes.count(argument) != 0) {
+            error = "PID " + argument + " already watched";
+        } else if (!dirExists(procRoot() + "/" + argument + "/")) {
+            error = "PID " + argument + " does not exist";
+        } else {
+            processes.insert(std::make_pair(argument, Process(argument)));
+            if (run.processTrees) {
+                run.trees->addRoot(pid);
+            }
+        }
+    } else if (command == "remove") {
+        if (run.monitorAll) {
+            error = "all processes are watched (-a)";
+        } else if (!parsePID(argument, pid) || processes.count(argument) == 0) {
+            error = "PID '" + argument + "' not watched";
+        } else {
+            for (ProcessMap::iterator processIt = processes.begin(); processIt != processes.end(); ) {
+                if (processIt->second.tgid == pid) {
+                    eraseProcess(processes, processIt++, *run.trees);
+                } else {
+                    ++processIt;
+                }
+            }
+        }
+    } else if (command == "fields") {
+        const std::set<int> fields = argument == "all" ? std::set<int>() : parseFieldsFromString(argument);
+        if (run.fixedFields) {
+            error = "fields cannot be changed while recording (-C)";
+        } else if (fields.empty() && argument != "all") {
+            error = "invalid fields '" + argument + "'";
+        } else {
+            // the column to rank processes by has to be read even if it is not written
+            std::set<int> readFields = fields;
+            if (run.top.count > 0 && !fields.empty()) {
+                readFields.insert(run.top.column);
+            }
+            for (unsigned int sampler = 0; sampler < run.samplers->size(); ++sampler) {
+                (*run.samplers)[sampler]->setFields(readFields, run.schedStatCPU);
+            }
+
+            run.fields = fields;
+            delete run.changeFilter;
+            run.changeFilter = run.changesOnly ? new ChangeFilter(fields, run.changePolicy) : NULL;
+            delete run.output;
+            if (!createLiveOutput(run)) {
+                run.ringName.clear();
+                createLiveOutput(run);
+                error = "could not recreate the shared memory ring, rows are no longer published to it";
+            }
+            run.output->writeHeader();
+            run.control->publish(run.controlOutput->header() + "\n");
+        }
+    } else if (command == "interval") {
+        char* end = NULL;
+        const double delaySecs = strtod(argument.c_str(), &end);
+        if (run.fixedInterval) {
+            error = "the interval cannot be changed with -g";
+        } else if (argument.empty() || *end != '\0' || !(delaySecs >= 0.0 && delaySecs < 1e9)) {
+            error = "invalid interval '" + argument + "'";
+        } else {
+            TimeSpec nowTS;
+            clock_gettime(clockSource, &nowTS.ts);
+            run.delaySecs = delaySecs;
+            run.scheduler->setInterval(delaySecs, nowTS);
+        }
+    } else {
+        error = "unknown command '" + command + "'";
+    }
+
+    if (!error.empty()) {
+        run.control->reply(request.client, "error: " + error + "\n\n");
+    } else {
+        run.control->reply(request.client, "ok\n" + data.str() + "\n");
+    }
+}
+
+/// answers the requests of clients of the control socket, waits for further requests until the next iteration
+/// is due if @p untilDue is set
+void serveControlRequests(LiveRun& run, const bool untilDue) {
+    if (!run.control->isOpen()) return;
+
+    for (;;) {
+        TimeSpec nowTS;
+        clock_gettime(clockSource, &nowTS.ts);
+        const TimeSpec& wakeupTS = run.scheduler->scheduled();
+        const bool due = !untilDue || !(wakeupTS > nowTS);
+
+        run.control->wait(due ? TimeSpec() : wakeupTS - nowTS);
+        ControlSocket::Request request;
+        while (run.control->nextRequest(request)) {
+            handleControlRequest(run, request);
+        }
+        if (due || terminateRequested) break;
+    }
+}
+
+/// writes all buffered output of the writer thread, if any, and reports dropped output
+void finishOutput(AsyncWriter* asyncWriter, const WriterPolicy& writerPolicy, const int logFD) {
+    if (!asyncWriter) return;
+
+    const unsigned long overruns = asyncWriter->getOverruns();
+    delete asyncWriter;
+    if (writerPolicy.overflow == WriterPolicy::OverflowCount && overruns > 0) {
+        std::cerr << "warning: output buffer was full, dropped output of " << overruns << " iterations" << std::endl;
+    }
+    if (logFD != STDOUT_FILENO) close(logFD);
+}
+
 void printUsage(const std::string& name) {
     std::cout << "Usage: " << name << " [OPTIONS] PID(s)" << std::endl
               << "  -a        monitor all processes" << std::endl
+              << "  -A source source of CPU times for 'AvgCPUPerc' and 'CurCPUPerc', either 'jiffies' (default)" << std::endl
+              << "            or 'schedstat', which is accurate in nanoseconds even at intervals below the kernel" << std::endl
+              << "            clock tick rate, multi-threaded processes still use jiffies unless watched per thread (-T)" << std::endl
+              << "  -b source source to read process information from, either 'proc' (default) or 'taskstats'," << std::endl
+              << "            taskstats requires the CAP_NET_ADMIN capability, falls back to 'proc' if unavailable" << std::endl
+              << "  -c        track processes via the kernel's process events instead of checking /proc in" << std::endl
+              << "            every iteration, /proc is still rescanned every " << processRescanSecs << " seconds," << std::endl
+              << "            requires the CAP_NET_ADMIN capability, falls back to checking /proc if unavailable" << std::endl
+              << "  -C        record the raw contents of all files read from /proc instead of writing the status" << std::endl
+              << "            of the processes, replay the recording later with -R (implies '-b proc')" << std::endl
               << "  -d delay  delay in seconds between intervals (default: 0.5), specify '-1' to use" << std::endl
               << "            2 * kernel clock tick rate (2 * 1/100 on most systems), note: values equal or below"<< std::endl
               << "            the kernel clock tick rate will lead to bogus values for the 'CurCPUPerc' field" << std::endl
+              << "  -D policy only write a row if the process has changed, policy is a comma-separated list of:" << std::endl
+              << "            heartbeat=SECS  write a row at least every SECS seconds, 0 for never (default: 60)" << std::endl
+              << "            cpu=PERC        write rows while 'CurCPUPerc' is at least PERC (default: 1)" << std::endl
+              << "            io=BYTES        write rows while reading or writing at least BYTES per second (default: 1)" << std::endl
+              << "            rows are also written if any other field than runtime, averages and rates has changed" << std::endl
+              << "            and once more when the process has become idle, e.g. '-D heartbeat=10,cpu=5'," << std::endl
+              << "            '-D heartbeat=60' uses the defaults" << std::endl
               << "  -e cmd    program to execute and watch, all remaining arguments will be forwarded" << std::endl
               << "  -f fields names of fields to show, separated by comma (default: all)" << std::endl
+              << "  -g groups read some files less often than every interval, groups is a comma-separated list of" << std::endl
+              << "            file=SECS with file being one of stat, status, io or schedstat, periods are rounded to" << std::endl
+              << "            multiples of the delay, values of files not read keep their last value," << std::endl
+              << "            e.g. '-d 0.01 -g io=0.1,status=1'" << std::endl
+              << "  -j num    number of threads for reading processes (default: 1)" << std::endl
               << "  -k        show kernel threads (default: false)" << std::endl
+              << "  -l socket listen on the Unix domain socket for requests, one per line: 'get [PID]' returns the" << std::endl
+              << "            latest rows, 'subscribe' streams the rows of each iteration, 'add PID' and 'remove PID'" << std::endl
+              << "            change the watched processes, 'fields FIELDS|all' and 'interval SECS' the fields and" << std::endl
+              << "            delay, rows are sent as CSV, see README.md for the replies, no PIDs required, the" << std::endl
+              << "            socket is created with mode 0600, so only the user running audria can connect" << std::endl
+              << "  -L policy write the output given by -o into preallocated, memory-mapped segments file.0, file.1," << std::endl
+              << "            ... rotated between iterations, each starting with a header, policy is a comma-separated" << std::endl
+              << "            list of:" << std::endl
+              << "            size=BYTES  preallocated size, rotate once a segment holds that much (default: 67108864)" << std::endl
+              << "            age=SECS    rotate segments older than SECS, 0 for never (default: 0)" << std::endl
+              << "            keep=N      delete the oldest segments beyond N, 0 to keep all (default: 0)" << std::endl
+              << "            e.g. '-o data.txt -L size=1073741824,keep=10', '-L size=67108864' uses the defaults" << std::endl
+              << "  -m ring   also publish all rows to the POSIX shared memory segment name[,slots] for any number" << std::endl
+              << "            of readers, a lock-free ring of the latest slots rows (default: " << defaultRingSlots << ")" << std::endl
+              << "            in the binary format, see SharedRing.h, read it with audria-shm or SharedRingReader" << std::endl
               << "  -n num    number of iterations before quitting (default: unlimited)" << std::endl
               << "  -o file   file to write output to instead of stdout, will append to existing files," << std::endl
               << "            if file is '-' then output will be written to stdout (default)" << std::endl
+              << "  -O policy what to do if an iteration takes longer than the interval, either 'skip' (default)" << std::endl
+              << "            to skip iterations, 'stretch' to stretch the interval or 'stagger' to read the" << std::endl
+              << "            processes round-robin in several iterations, i.e. each process less often," << std::endl
+              << "            'IntervalSecs' holds the time since a process has been read before" << std::endl
+              << "  -p dir    read process information from dir instead of /proc, e.g. a tree created by" << std::endl
+              << "            audria-procgen, -b and -c still query the running kernel" << std::endl
+              << "  -P rows   also watch all descendants of the given PIDs and of the program executed by -e," << std::endl
+              << "            write one row per process tree with the sum of CPU usage, memory, IO and threads," << std::endl
+              << "            including the counters of terminated descendants, and the number of processes in" << std::endl
+              << "            'Processes', rows is either 'sum' (trees only) or 'all' (also each process)" << std::endl
               << "  -r        acquire real-time priority (lowest niceness, highest scheduling priority)," << std::endl
               << "            usually requires root privileges or the CAP_SYS_NICE capability" << std::endl
+              << "  -R file   replay a recording made with -C instead of reading /proc, calculates the fields" << std::endl
+              << "            given by -f, no PIDs required" << std::endl
               << "  -s        include self in list of processes to monitor" << std::endl
+              << "  -S file   write statistics about audria's own overhead and the precision of its intervals" << std::endl
+              << "            to file, one line per interval and a summary on exit, '-' writes to stderr" << std::endl
+              << "  -t top    only write the rows of the processes with the highest values in each iteration," << std::endl
+              << "            in descending order, top is num[,field] with field defaulting to CurCPUPerc," << std::endl
+              << "            e.g. '-t 10,VmRsskB' or '-t 5,CurReadBytesStoragePerSec'" << std::endl
+              << "  -T        also monitor each thread of the monitored processes, one row per thread with the" << std::endl
+              << "            PID of its process and its own TID, memory fields are only shown for processes" << std::endl
+              << "  -u        read files from /proc in batches via io_uring, falls back to reading them one by one" << std::endl
+              << "            if unavailable" << std::endl
+              << "  -w format output format, either 'csv' (default), 'binary' or 'compressed', convert binary and" << std::endl
+              << "            compressed output to CSV with audria-dump" << std::endl
+              << "  -W policy write output from a separate thread, policy is a comma-separated list of:" << std::endl
+              << "            flush=tick|bytes:N|time:SECS  when to write buffered output (default: tick)" << std::endl
+              << "            full=block|drop|count         what to do with a tick's output if the buffer is full," << std::endl
+              << "                                          count drops it and reports overruns on exit (default: count)" << std::endl
+              << "            size=N                        buffer size in bytes (default: 4194304)" << std::endl
+              << "            e.g. '-W flush=time:1,full=drop', '-W flush=tick' uses the defaults" << std::endl
               << "  -h        print this help and exit" << std::endl;
     return;
 }
@@ -123,6 +1207,8 @@ void printUsage(const std::string& name) {
 int main(int argc, char* argv[]) {
     // check if we have all column header
     assert(StatusColumnCount == sizeof(statusColumnHeader) / sizeof(statusColumnHeader[0]));
+    assert(StatusColumnCount == sizeof(statusColumnType) / sizeof(statusColumnType[0]));
+    assert(StatusColumnCount <= 64); // has to fit into ProcessStatus::valid
     
     if (argc < 2) {
         std::cerr << argv[0] << ": no arguments specified" << std::endl;
@@ -135,20 +1221,73 @@ int main(int argc, char* argv[]) {
     bool monitorOwn  = false;
     bool monitorKThreads = false;
     bool rtPriority  = false;
+    bool useTaskStats = false;
+    bool useProcEvents = false;
+    bool useUring    = false;
+    OutputFormat outputFormat = FormatCsv;
+    bool asyncOutput = false;
+    bool segmentedOutput = false;
+    bool captureRaw  = false;
+    bool monitorThreads = false;
+    bool schedStatCPU = false;
+    bool processTrees = false;
+    bool treeProcessRows = false;
+    TickScheduler::Policy overloadPolicy = TickScheduler::Skip;
+    bool changesOnly = false;
+    TopRows top;
+    ChangePolicy changePolicy;
+    WriterPolicy writerPolicy;
+    SegmentPolicy segmentPolicy;
     double delaySecs = 0.5;
     int iterations   = 0;
+    int threads      = 1;
     std::set<int> fields;
     std::vector<char*> executeCmd;
-    std::ofstream logFile;
+    const char* logFileName = NULL;
+    const char* statsFileName = NULL;
+    const char* replayFileName = NULL;
+    const char* fileGroups = NULL;
+    const char* controlPath = NULL;
+    std::string ringName;
+    uint64_t ringSlots = defaultRingSlots;
+    unsigned int dueEvery[FileKindCount] = {1, 1, 1, 1}; // iterations between reads of each file
     
     // parse command line arguments
     // note: on errors we try to mimic getopt()'s error message as they have a funny style
     int c;
-    while ((c = getopt(argc, argv, "ad:e:f:kn:o:rsh")) != -1) {
+    while ((c = getopt(argc, argv, "aA:b:cCd:D:e:f:g:j:kl:L:m:n:o:O:p:P:rR:sS:t:Tuw:W:h")) != -1) {
         switch (c) {
             case 'a':
                 monitorAll = true;
                 break;
+            case 'A':
+                if (std::string(optarg) == "schedstat") {
+                    schedStatCPU = true;
+                } else if (std::string(optarg) == "jiffies") {
+                    schedStatCPU = false;
+                } else {
+                    std::cerr << argv[0] << ": option requires 'jiffies' or 'schedstat' as argument -- '" << (char)c << "'" << std::endl;
+                    printUsage(argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'b':
+                if (std::string(optarg) == "taskstats") {
+                    useTaskStats = true;
+                } else if (std::string(optarg) == "proc") {
+                    useTaskStats = false;
+                } else {
+                    std::cerr << argv[0] << ": option requires 'proc' or 'taskstats' as argument -- '" << (char)c << "'" << std::endl;
+                    printUsage(argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'c':
+                useProcEvents = true;
+                break;
+            case 'C':
+                captureRaw = true;
+                break;
             case 'd':
                 if (std::string(optarg) == "-1") {
                     delaySecs = 2 / (double)getHertz();
@@ -165,6 +1304,14 @@ int main(int argc, char* argv[]) {
                     exit(EXIT_FAILURE);
                 }
                 break;
+            case 'D':
+                changesOnly = true;
+                if (!parseChangePolicy(optarg, changePolicy)) {
+                    std::cerr << argv[0] << ": could not parse change policy -- '" << (char)c << "'" << std::endl;
+                    printUsage(argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                break;
             case 'e':
                 executeCmd.push_back(optarg);
                 // gather all remaining arguments
@@ -180,9 +1327,44 @@ int main(int argc, char* argv[]) {
                     exit(EXIT_FAILURE);
                 }
                 break;
+            case 'g':
+                fileGroups = optarg;
+                break;
+            case 'j':
+                if (isNumber(optarg)) {
+                    threads = stringToNumber<int>(optarg);
+                    if (threads < 1) {
+                        std::cerr << argv[0] << ": option requires a positive number as argument -- '" << (char)c << "'" << std::endl;
+                        printUsage(argv[0]);
+                        exit(EXIT_FAILURE);
+                    }
+                } else {
+                    std::cerr << argv[0] << ": option requires a number as argument -- '" << (char)c << "'" << std::endl;
+                    printUsage(argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                break;
             case 'k':
                 monitorKThreads = true;
                 break;
+            case 'l':
+                controlPath = optarg;
+                break;
+            case 'L':
+                segmentedOutput = true;
+                if (!parseSegmentPolicy(optarg, segmentPolicy)) {
+                    std::cerr << argv[0] << ": could not parse segment policy -- '" << (char)c << "'" << std::endl;
+                    printUsage(argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'm':
+                if (!parseSharedRing(optarg, ringName, ringSlots)) {
+                    std::cerr << argv[0] << ": option requires a name and optionally a positive number as argument -- '" << (char)c << "'" << std::endl;
+                    printUsage(argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                break;
             case 'n':
                 if (isNumber(optarg)) {
                     iterations = stringToNumber<int>(optarg);
@@ -198,20 +1380,87 @@ int main(int argc, char* argv[]) {
                 }
                 break;
             case 'o':
-                if (std::string(optarg) != "-") {
-                    logFile.open(optarg, std::ios::app);
-                    if (!logFile) {
-                        std::cerr << argv[0] << ": could not open file '" << optarg << "'' for appending: " << strerror(errno) << std::endl;
-                        exit(EXIT_FAILURE);
-                    }
+                logFileName = std::string(optarg) != "-" ? optarg : NULL;
+                break;
+            case 'O':
+                if (std::string(optarg) == "skip") {
+                    overloadPolicy = TickScheduler::Skip;
+                } else if (std::string(optarg) == "stretch") {
+                    overloadPolicy = TickScheduler::Stretch;
+                } else if (std::string(optarg) == "stagger") {
+                    overloadPolicy = TickScheduler::Stagger;
+                } else {
+                    std::cerr << argv[0] << ": option requires 'skip', 'stretch' or 'stagger' as argument -- '" << (char)c << "'" << std::endl;
+                    printUsage(argv[0]);
+                    exit(EXIT_FAILURE);
                 }
                 break;
+            case 'p':
+                if (!dirExists(optarg)) {
+                    std::cerr << argv[0] << ": option requires a directory as argument -- '" << (char)c << "'" << std::endl;
+                    printUsage(argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                setProcRoot(optarg);
+                break;
+            case 'P':
+                if (std::string(optarg) == "sum") {
+                    treeProcessRows = false;
+                } else if (std::string(optarg) == "all") {
+                    treeProcessRows = true;
+                } else {
+                    std::cerr << argv[0] << ": option requires 'sum' or 'all' as argument -- '" << (char)c << "'" << std::endl;
+                    printUsage(argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                processTrees = true;
+                break;
             case 'r':
                 rtPriority = true;
                 break;
+            case 'R':
+                replayFileName = optarg;
+                break;
             case 's':
                 monitorOwn = true;
                 break;
+            case 'S':
+                statsFileName = optarg;
+                break;
+            case 't':
+                if (!parseTopRows(optarg, top)) {
+                    std::cerr << argv[0] << ": option requires a positive number and optionally a field as argument -- '" << (char)c << "'" << std::endl;
+                    printUsage(argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'T':
+                monitorThreads = true;
+                break;
+            case 'u':
+                useUring = true;
+                break;
+            case 'w':
+                if (std::string(optarg) == "binary") {
+                    outputFormat = FormatBinary;
+                } else if (std::string(optarg) == "compressed") {
+                    outputFormat = FormatCompressed;
+                } else if (std::string(optarg) == "csv") {
+                    outputFormat = FormatCsv;
+                } else {
+                    std::cerr << argv[0] << ": option requires 'csv', 'binary' or 'compressed' as argument -- '" << (char)c << "'" << std::endl;
+                    printUsage(argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'W':
+                asyncOutput = true;
+                if (!parseWriterPolicy(optarg, writerPolicy)) {
+                    std::cerr << argv[0] << ": could not parse writer policy -- '" << (char)c << "'" << std::endl;
+                    printUsage(argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                break;
             case 'h':
                 printUsage(argv[0]);
                 exit(EXIT_SUCCESS);
@@ -225,21 +1474,187 @@ int main(int argc, char* argv[]) {
         }
     }
 
-    // check if specified delay is valid
-    if (delaySecs <= 1 / (double)getHertz() &&
-        (fields.empty() || fields.count(CurCPUPerc) == 1)) {
-        std::cerr << "warning: interval " << delaySecs << " equal or below "
+    // read files only every few iterations if requested
+    if (fileGroups) {
+        if (delaySecs == 0.0 || !parseFileGroups(fileGroups, delaySecs, dueEvery)) {
+            std::cerr << argv[0] << ": could not parse file groups or no delay given -- 'g'" << std::endl;
+            printUsage(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+
+        // don't wake up in iterations without any file due
+        unsigned int common = dueEvery[0];
+        for (int kind = 1; kind < FileKindCount; ++kind) {
+            common = greatestCommonDivisor(common, dueEvery[kind]);
+        }
+        delaySecs *= common;
+        for (int kind = 0; kind < FileKindCount; ++kind) {
+            dueEvery[kind] /= common;
+        }
+    }
+
+    // check if specified delay is valid, nanoseconds from schedstat don't depend on the kernel tick rate
+    const bool checkCPUField = !schedStatCPU && (fields.empty() || fields.count(CurCPUPerc) == 1);
+    const double cpuDelaySecs = delaySecs * dueEvery[FileStat];
+    if (cpuDelaySecs <= 1 / (double)getHertz() && checkCPUField) {
+        std::cerr << "warning: interval " << cpuDelaySecs << " equal or below "
                   << "kernel tick rate (" << (1.0 / (double)getHertz()) << "), "
                   << "expect bogus values for the 'CurCPUPerc' field" << std::endl;
-    } else if (fmod(getHertz(), (1.0 / (double) delaySecs)) != 0 &&
-               (fields.empty() || fields.count(CurCPUPerc) == 1)) {
-        std::cerr << "warning: iterations per second (" << (1.0 / delaySecs) << ") not a multiple of "
+    } else if (fmod(getHertz(), (1.0 / (double) cpuDelaySecs)) != 0 && checkCPUField) {
+        std::cerr << "warning: iterations per second (" << (1.0 / cpuDelaySecs) << ") not a multiple of "
                   << "kernel ticks per second (" << (double)getHertz() << "), "
                   << "expect bogus values for the 'CurCPUPerc' field" << std::endl;
     }
 
-    // output device
-    std::ostream& log = logFile.is_open() ? logFile : std::cout;
+    if (captureRaw && replayFileName) {
+        std::cerr << argv[0] << ": options -C and -R cannot be combined" << std::endl;
+        printUsage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    if (captureRaw && useTaskStats) {
+        std::cerr << "warning: taskstats cannot be recorded, reading from /proc instead" << std::endl;
+        useTaskStats = false;
+    }
+    if (overloadPolicy == TickScheduler::Stagger && (processTrees || fileGroups)) {
+        // trees have to be summed up over all of their processes at once, file groups are due in certain iterations only
+        std::cerr << argv[0] << ": -O stagger cannot be combined with -P or -g" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if (captureRaw && (overloadPolicy == TickScheduler::Stagger || fileGroups)) {
+        // a replay forgets processes and their files as soon as they are missing from an iteration
+        std::cerr << argv[0] << ": recordings hold every process in every iteration, "
+                  << "-C cannot be combined with -O stagger or -g" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if (controlPath && replayFileName) {
+        std::cerr << argv[0] << ": replays cannot be controlled, -l cannot be combined with -R" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if (segmentedOutput && (!logFileName || asyncOutput || captureRaw || replayFileName)) {
+        // recordings only store the difference to the previous content of each file, so they cannot be split
+        std::cerr << argv[0] << ": -L requires a file given by -o and cannot be combined with -W, -C or -R" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if (captureRaw && !ringName.empty()) {
+        std::cerr << argv[0] << ": recordings hold no rows to publish, -m cannot be combined with -C" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if (processTrees && (captureRaw || replayFileName)) {
+        std::cerr << argv[0] << ": process trees cannot be recorded or replayed, -P cannot be combined with -C or -R" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if (captureRaw && asyncOutput && writerPolicy.overflow != WriterPolicy::OverflowBlock) {
+        // a recording only stores the difference to the previous content of each file
+        std::cerr << argv[0] << ": recordings must not be dropped, -C requires full=block with -W" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // the column to rank processes by has to be read even if it is not written
+    std::set<int> readFields = fields;
+    if (top.count > 0 && !fields.empty()) {
+        readFields.insert(top.column);
+    }
+
+    // set up one sampler per thread, each with its own buffer and taskstats connection and io_uring if requested
+    SamplingJob samplingJob;
+    for (int thread = 0; thread < threads; ++thread) {
+        Sampler* sampler = new Sampler(readFields, useTaskStats, useUring, monitorKThreads, statsFileName != NULL, captureRaw,
+                                       schedStatCPU);
+        if (useTaskStats && !sampler->taskStats.isOpen()) {
+            std::cerr << "warning: taskstats not available, reading from /proc instead" << std::endl;
+            useTaskStats = false;
+        }
+        if (useUring && !sampler->uring.isOpen()) {
+            std::cerr << "warning: io_uring not available, reading files one by one instead" << std::endl;
+            useUring = false;
+        }
+        samplingJob.samplers.push_back(sampler);
+    }
+    if (!useTaskStats &&
+        (fields.count(CPUDelayTotalNs) || fields.count(BlkIODelayTotalNs) || fields.count(SwapinDelayTotalNs))) {
+        std::cerr << "warning: delay accounting fields are only available via taskstats" << std::endl;
+    }
+
+    // subscribe to process events if requested
+    ProcEventListener procEvents;
+    if (useProcEvents && !procEvents.open()) {
+        std::cerr << "warning: process events not available, checking /proc in every iteration instead" << std::endl;
+    }
+
+    // keep as many files from /proc/pid/ open as we can
+    const unsigned long openFileLimit = raiseOpenFileLimit();
+    ProcFile::setMaxOpenFiles(openFileLimit > reservedFiles ? openFileLimit - reservedFiles : 0);
+
+    // output device, either written directly, by a separate writer thread or into memory-mapped segments
+    std::ofstream logFile;
+    int logFD = STDOUT_FILENO;
+    SegmentWriter* segmentWriter = NULL;
+    if (segmentedOutput) {
+        segmentWriter = new SegmentWriter(logFileName, segmentPolicy);
+        if (!segmentWriter->open()) {
+            exit(EXIT_FAILURE);
+        }
+    } else if (logFileName && !asyncOutput) {
+        logFile.open(logFileName, std::ios::app | std::ios::binary);
+        if (!logFile) {
+            std::cerr << argv[0] << ": could not open file '" << logFileName << "'' for appending: " << strerror(errno) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    } else if (logFileName) {
+        logFD = open(logFileName, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0666);
+        if (logFD == -1) {
+            std::cerr << argv[0] << ": could not open file '" << logFileName << "'' for appending: " << strerror(errno) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    AsyncWriter* asyncWriter = asyncOutput ? new AsyncWriter(logFD, writerPolicy) : NULL;
+    std::ostream asyncLog(asyncWriter);
+    std::ostream segmentLog(segmentWriter);
+    std::ostream& log = asyncWriter ? asyncLog : segmentWriter ? segmentLog : logFile.is_open() ? logFile : std::cout;
+
+    // statistics about ourselves
+    std::ofstream statsFile;
+    if (statsFileName && std::string(statsFileName) != "-") {
+        statsFile.open(statsFileName, std::ios::app);
+        if (!statsFile) {
+            std::cerr << argv[0] << ": could not open file '" << statsFileName << "'' for appending: " << strerror(errno) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    SelfStats* selfStats = statsFileName ? new SelfStats(statsFile.is_open() ? statsFile : std::cerr) : NULL;
+
+    // stop cleanly on signals to write all buffered output and statistics
+    if (asyncWriter || selfStats || controlPath || segmentWriter) {
+        signal(SIGINT,  requestTermination);
+        signal(SIGTERM, requestTermination);
+    }
+
+    // suppress rows of processes which haven't changed if requested
+    const ChangeFilter* changeFilter = changesOnly ? new ChangeFilter(fields, changePolicy) : NULL;
+
+    // calculate the status of recorded processes instead of reading /proc if requested
+    if (replayFileName) {
+        std::ifstream replayFile(replayFileName, std::ios::binary);
+        if (!replayFile) {
+            std::cerr << argv[0] << ": could not open file '" << replayFileName << "'' for reading: " << strerror(errno) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        Output* output = createOutput(outputFormat, log, fields, ringName.empty() ? NULL : ringName.c_str(), ringSlots);
+        if (!output) {
+            exit(EXIT_FAILURE);
+        }
+        output->writeHeader();
+        const bool replayed = replayRecording(replayFile, *samplingJob.samplers[0], *output, top, changeFilter, log);
+        delete output;
+        delete changeFilter;
+        for (unsigned int sampler = 0; sampler < samplingJob.samplers.size(); ++sampler) {
+            delete samplingJob.samplers[sampler];
+        }
+        delete selfStats;
+        finishOutput(asyncWriter, writerPolicy, logFD);
+        return replayed ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
     
     // add self if requested
     ProcessMap processes;
@@ -248,15 +1663,19 @@ int main(int argc, char* argv[]) {
         processes.insert(std::make_pair(ownPID, Process(ownPID)));
     }
 
-    // all remaining arguments have to be PIDs
+    // all remaining arguments have to be PIDs, which are the roots of process trees if requested
+    ProcessTrees trees;
     for (; optind < argc; ++optind) {
         const std::string pid(argv[optind]);
         if (isNumber(pid)) {
-            std::string fileName = "/proc/" + pid + "/";
+            std::string fileName = procRoot() + "/" + pid + "/";
 
             // check if PID exists
             if (dirExists(fileName)) {
                 processes.insert(std::make_pair(pid, Process(pid)));
+                if (processTrees) {
+                    trees.addRoot(atoi(pid.c_str()));
+                }
             } else {
                 std::cerr << "cannot watch PID, could not open " << fileName << ": " << strerror(errno) << std::endl;
                 exit(EXIT_FAILURE);
@@ -286,10 +1705,19 @@ int main(int argc, char* argv[]) {
             std::cerr << "successfully spawned child " << childPid << std::endl;
             const std::string& childPidStr = numberToString(childPid);
             processes.insert(std::make_pair(childPidStr, Process(childPidStr)));
+            if (processTrees) {
+                trees.addRoot(childPid);
+            }
         }
     }
     
-    if (processes.empty() && !monitorAll) {
+    // answer requests of clients if requested, which may add processes later on
+    ControlSocket control;
+    if (controlPath && !control.open(controlPath)) {
+        exit(EXIT_FAILURE);
+    }
+
+    if (processes.empty() && !monitorAll && !control.isOpen()) {
         std::cerr << "no PID(s) specified" << std::endl;
         printUsage(argv[0]);
         exit(EXIT_FAILURE);
@@ -315,26 +1743,78 @@ int main(int argc, char* argv[]) {
         }
     }
 
-    // print column headers
-    log << "Time";
-    for (int statusColumn = 0; statusColumn < StatusColumnCount; ++statusColumn) {
-        // skip unwanted fields
-        if (!fields.empty() && fields.count(statusColumn) == 0) continue;
-        log << "," << statusColumnHeader[statusColumn];
+    // state which clients of the control socket can change
+    TickScheduler scheduler(overloadPolicy, delaySecs);
+    LiveRun run;
+    run.processes     = &processes;
+    run.trees         = &trees;
+    run.samplers      = &samplingJob.samplers;
+    run.scheduler     = &scheduler;
+    run.control       = &control;
+    run.log           = &log;
+    run.changeFilter  = changeFilter;
+    run.fields        = fields;
+    run.delaySecs     = delaySecs;
+    run.outputFormat  = outputFormat;
+    run.ringName      = ringName;
+    run.ringSlots     = ringSlots;
+    run.changesOnly   = changesOnly;
+    run.changePolicy  = changePolicy;
+    run.top           = top;
+    run.schedStatCPU  = schedStatCPU;
+    run.processTrees  = processTrees;
+    run.monitorAll    = monitorAll;
+    run.fixedFields   = captureRaw;
+    run.fixedInterval = fileGroups != NULL;
+
+    // print column headers, a recording starts with its own header instead and holds no rows, so it has no output
+    if (captureRaw) {
+        std::string header;
+        Recording::appendHeader(header);
+        log.write(header.data(), header.size());
+    } else {
+        if (!createLiveOutput(run)) {
+            exit(EXIT_FAILURE);
+        }
+        run.output->writeHeader();
+    }
+    if (selfStats) {
+        selfStats->writeHeader();
     }
-    log << std::endl;
     
-    const TimeSpec intervalTS(delaySecs);
-    TimeSpec wakeupTS;
-    clock_gettime(clockSource, &wakeupTS.ts);
+    TimeSpec startTS;
+    clock_gettime(clockSource, &startTS.ts);
+    scheduler.start(startTS);
+
+    const TimeSpec rescanIntervalTS(processRescanSecs);
+    TimeSpec nextRescanTS; // rescan /proc in the first iteration
     
+    WorkerPool* samplingPool = threads > 1 ? new WorkerPool(threads) : NULL;
+
+    std::vector<Process*> rows; // processes to write in the current iteration
+
+    int exitStatus = EXIT_SUCCESS;
     int i = 0;
-    while (iterations == 0 || ++i <= iterations) {
+    unsigned long iteration = 0; // i is not counted without an iteration limit
+    while ((iterations == 0 || ++i <= iterations) && !terminateRequested) {
+        TimeSpec tickTS;
+        if (captureRaw) {
+            clock_gettime(clockSource, &tickTS.ts);
+        }
+
+        if (selfStats) {
+            // without delay every iteration is on time
+            TimeSpec scheduledTS = scheduler.scheduled();
+            if (delaySecs == 0.0) {
+                clock_gettime(clockSource, &scheduledTS.ts);
+            }
+            selfStats->beginTick(scheduledTS);
+        }
+
         // check if process to execute is still running
         int childStatus;
         if (childPid != -1 && !waitpid(childPid, &childStatus, WNOHANG) == 0) {
             std::cerr << "child " << childPid << " terminated, exiting" << std::endl;
-            int exitStatus;
             if (WIFSIGNALED(childStatus)) {
               exitStatus = 128 + WTERMSIG(childStatus);
             } else if (WIFEXITED(childStatus)) {
@@ -342,96 +1822,198 @@ int main(int argc, char* argv[]) {
             } else {
               exitStatus = 1;
             }
-            exit(exitStatus);
+            break;
         }
 
-        // check if all processes still exist, remove terminated ones
-        for (ProcessMap::iterator processIt = processes.begin(); processIt != processes.end(); ) {
-            if (!processIt->second.exists()) {
-                processes.erase(processIt++);
-            } else {
-                ++processIt;
+        // track new and terminated processes via process events, only rescan /proc from time to time
+        bool rescan = true;
+        if (procEvents.isOpen()) {
+            ProcEventList events;
+            const bool complete = procEvents.receive(events);
+            applyProcEvents(events, processes, monitorAll, trees);
+
+            TimeSpec curTS;
+            clock_gettime(clockSource, &curTS.ts);
+            rescan = !complete || curTS > nextRescanTS;
+            if (unlikely(!complete)) {
+                std::cerr << "warning: lost process events, rescanning /proc" << std::endl;
+            }
+            if (rescan) {
+                nextRescanTS = curTS + rescanIntervalTS;
             }
         }
 
-        // check if there are new processes
-        if (monitorAll) {
-            const PIDSet& pidSet = ProcReader::pids();
+        if (rescan) {
+            // check if all processes read in this iteration still exist, remove terminated ones,
+            // also those whose files could not be read anymore, their PID may have been reused by a new process
+            // which is added again below with newly opened files
+            for (ProcessMap::iterator processIt = processes.begin(); processIt != processes.end(); ) {
+                const Process& process = processIt->second;
+                if (scheduler.isDue(process.tgid) && (process.vanished || !process.exists())) {
+                    eraseProcess(processes, processIt++, trees);
+                } else {
+                    ++processIt;
+                }
+            }
+
+            // check if there are new processes, only the parents of processes not seen before are read for trees
+            if (monitorAll || !trees.isEmpty()) {
+                const PIDSet& pidSet = ProcReader::pids();
 
-            for (PIDSet::const_iterator it = pidSet.begin(); it != pidSet.end(); ++it) {
-                if (processes.count(*it) == 0) {
-                    processes.insert(std::make_pair(*it, Process(*it)));
+                std::vector<std::string> added;
+                trees.scan(pidSet, added);
+                const PIDSet& newSet = monitorAll ? pidSet : PIDSet(added.begin(), added.end());
+                for (PIDSet::const_iterator it = newSet.begin(); it != newSet.end(); ++it) {
+                    if (processes.count(*it) == 0) {
+                        processes.insert(std::make_pair(*it, Process(*it)));
+                    }
                 }
             }
         }
 
-        if (unlikely(processes.empty())) {
+        // clients of the control socket may add processes later on
+        if (unlikely(processes.empty()) && !control.isOpen()) {
             std::cerr << "no more processes to watch, exiting" << std::endl;
-            exit(EXIT_SUCCESS);
+            break;
         }
 
-        for (ProcessMap::iterator processIt = processes.begin(); processIt != processes.end(); ++processIt) {
-            TimeSpec curTS;
-            clock_gettime(clockSource, &curTS.ts);
-            Process& process = processIt->second;
-            const TimeSpec& elapsedTS = curTS - process.oldStatusTS;
+        // only read the files due in this iteration, all others keep their last values
+        if (fileGroups) {
+            bool due[FileKindCount];
+            for (int kind = 0; kind < FileKindCount; ++kind) {
+                due[kind] = iteration % dueEvery[kind] == 0;
+            }
+            for (unsigned int sampler = 0; sampler < samplingJob.samplers.size(); ++sampler) {
+                samplingJob.samplers[sampler]->setDue(due);
+            }
+        }
+        ++iteration;
 
-            ProcReader pr(process.pid);
-            pr.readAll();
+        // the uptime is the same for all processes of this iteration
+        const double uptimeSecs = uptime();
+        for (unsigned int sampler = 0; sampler < samplingJob.samplers.size(); ++sampler) {
+            samplingJob.samplers[sampler]->setUptime(uptimeSecs);
+        }
 
-            if (!monitorKThreads && pr.isKernelThread()) {
-                continue;
+        // read all processes, possibly in parallel
+        samplingJob.processes.clear();
+        for (ProcessMap::iterator processIt = processes.begin(); processIt != processes.end(); ++processIt) {
+            if (scheduler.isDue(processIt->second.tgid)) {
+                samplingJob.processes.push_back(&processIt->second);
             }
+        }
+        samplingJob.next = 0;
+        if (samplingPool) {
+            samplingPool->run(sampleProcesses, &samplingJob);
+        } else {
+            sampleProcesses(&samplingJob, 0);
+        }
 
-            pr.updateCache();
-
-            pr.calcAll(process.oldStatusCache, elapsedTS.seconds());
+        // threads found now are read from the next iteration on
+        if (monitorThreads) {
+            updateThreads(processes);
+        }
 
-            const Cache& curCache = pr.getCache();
-            checkCacheConsistency(curCache, process.oldStatusCache);
+        // write the recorded files of all threads, each iteration starts with a tick record
+        if (captureRaw) {
+            std::string tick;
+            Recording::appendTick(tick, tickTS, uptimeSecs);
+            log.write(tick.data(), tick.size());
+            for (unsigned int sampler = 0; sampler < samplingJob.samplers.size(); ++sampler) {
+                std::string& recording = samplingJob.samplers[sampler]->recording;
+                log.write(recording.data(), recording.size());
+                recording.clear();
+            }
+        }
 
-            const ProcessStatus& curStatus = pr.getProcessStatus();
+        // print in order of the PIDs or the top processes only, followed by the sum of each process tree
+        for (ProcessMap::iterator processIt = processes.begin(); processIt != processes.end(); ++processIt) {
+            Process& process = processIt->second;
+            // a terminated process counts for its tree with its last status from now on
+            if (process.vanished && !process.files.thread) {
+                trees.remove(process.tgid, process.status);
+            }
+            if (!process.sampled) continue;
+            process.sampled = false;
 
-            log << curTS;
-            for (unsigned int statusColumn = 0; statusColumn < curStatus.size(); ++statusColumn) {
-                // skip unwanted fields
-                if (!fields.empty() && fields.count(statusColumn) == 0) continue;
+            if (!process.files.thread) {
+                trees.add(process.tgid, process.oldStatusTS, process.status);
+            }
+            if (captureRaw || (!treeProcessRows && trees.isMember(process.tgid))) continue;
+            rows.push_back(&process);
+        }
+        // start a new segment before writing this iteration's rows, each segment starts with a header
+        if (segmentWriter) {
+            TimeSpec curTS;
+            clock_gettime(clockSource, &curTS.ts);
+            if (segmentWriter->rotationDue(curTS) && segmentWriter->rotate()) {
+                run.output->writeHeader();
+            }
+        }
+        if (run.output) {
+            writeRows(rows, top, *run.output, run.changeFilter);
+            trees.writeRows(*run.output);
+        }
+        log.flush();
+        if (run.controlOutput) {
+            run.controlOutput->publishRows();
+        }
 
-                // if printing a program name containing a comma, enclose it in double-quotes (rfc4180 section 2.6)
-                if (unlikely(statusColumn == Name) &&
-                    unlikely(curStatus[statusColumn].find(",") != std::string::npos)) {
-                    log << ",\"" << curStatus[statusColumn] << "\"";
+        // remove processes which have been read a last time after they have exited
+        if (procEvents.isOpen()) {
+            for (ProcessMap::iterator processIt = processes.begin(); processIt != processes.end(); ) {
+                if (processIt->second.exited && scheduler.isDue(processIt->second.tgid)) {
+                    eraseProcess(processes, processIt++, trees);
                 } else {
-                    log << "," << curStatus[statusColumn];
+                    ++processIt;
                 }
             }
-            log << std::endl;
-
-            process.oldStatusCache = curCache;
-            process.oldStatusTS    = curTS;
         }
 
-        if (delaySecs != 0.0) {
+        if (run.delaySecs != 0.0) {
             TimeSpec curTS;
             clock_gettime(clockSource, &curTS.ts);
             
-            // calculate next wakeup time and make sure it is in the future
-            wakeupTS += intervalTS;
-            if (curTS > wakeupTS) {
-                const TimeSpec diffTS = curTS - wakeupTS;
-                unsigned int toSkip = 0;
-                do {
-                    wakeupTS += intervalTS;
-                    ++toSkip;
-                } while (curTS > wakeupTS);
-                std::cerr << "warning: interval too high, cannot keep up!"
-                          << " (" << diffTS << " seconds behind,"
-                          << " skipping " << toSkip << " iterations)" << std::endl;
+            // calculate next wakeup time, adapts the interval or the processes read if we cannot keep up
+            const unsigned int toSkip = scheduler.endTick(curTS);
+
+            if (selfStats) {
+                selfStats->endTick(samplingJob.processes.size(), toSkip);
             }
             
-            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wakeupTS.ts, NULL);
+            // answer requests of clients while waiting for the next iteration
+            if (control.isOpen()) {
+                serveControlRequests(run, true);
+            } else {
+                clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &scheduler.scheduled().ts, NULL);
+            }
+        } else {
+            if (selfStats) {
+                selfStats->endTick(samplingJob.processes.size(), 0);
+            }
+            serveControlRequests(run, false);
+        }
+    }
+
+    if (selfStats) {
+        std::vector<const SamplerStats*> samplerStats;
+        for (unsigned int sampler = 0; sampler < samplingJob.samplers.size(); ++sampler) {
+            samplerStats.push_back(&samplingJob.samplers[sampler]->stats);
         }
+        selfStats->writeSummary(&samplerStats[0], samplerStats.size());
+        delete selfStats;
     }
+
+    delete run.output;
+    delete run.changeFilter;
+    delete samplingPool;
+    for (unsigned int sampler = 0; sampler < samplingJob.samplers.size(); ++sampler) {
+        delete samplingJob.samplers[sampler];
+    }
+    log.flush();
+    delete segmentWriter;
+
+    finishOutput(asyncWriter, writerPolicy, logFD);
     
-    return 0;
+    return exitStatus;
 }
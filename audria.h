@@ -3,10 +3,18 @@
 
 #include "helper.h"
 #include "ProcCache.h"
+#include "ProcFile.h"
+#include "ProcReader.h"
+#include "Recording.h"
+#include "SelfStats.h"
+#include "TaskStatsReader.h"
+#include "UringReader.h"
 #include "TimeSpec.h"
 
 #include <map>
+#include <set>
 #include <string>
+#include <vector>
 
 // clock source for clock_gettime()
 #if defined(__linux) || defined(__linux__) || defined(linux)
@@ -24,14 +32,117 @@ typedef std::map<std::string, Process> ProcessMap;
 
 class Process {
   public:
-    Process(const std::string& processID) : pid(processID), status(), oldStatusCache(), oldStatusTS() {}
+    /// @param processID PID, 'PID/task/TID' for a single thread of a process
+    Process(const std::string& processID) :
+      pid(processID), tgid(atoi(processID.c_str())), files(processID), status(), oldStatusCache(), oldStatusTS(),
+      readTS(), sampled(false), exited(false), vanished(false), captured(), lastRow(), lastRowTS() {}
     /// returns whether the process still exists
-    bool exists() const { return dirExists("/proc/" + pid); }
+    bool exists() const { return dirExists(procRoot() + "/" + pid); }
 
-    std::string    pid;
-    ProcessStatus  status;
-    Cache          oldStatusCache;
-    TimeSpec       oldStatusTS;
+    std::string    pid;   ///< PID, 'PID/task/TID' for a single thread, i.e. the path below /proc
+    int            tgid;  ///< PID of the process, differs from the TID for threads
+    ProcFiles      files; ///< files from /proc/pid/, kept open during the lifetime of the process
+    ProcessStatus  status;         ///< status read in the last iteration
+    Cache          oldStatusCache; ///< cache from the last iteration
+    TimeSpec       oldStatusTS;    ///< time of the last iteration
+    TimeSpec       readTS[FileKindCount]; ///< time each file has been read last, zero if never
+    bool           sampled; ///< status has been read in the current iteration and should be printed
+    bool           exited; ///< process has been terminated according to a process event
+    bool           vanished; ///< process could not be read in the current iteration, e.g. it has been terminated
+    std::string    captured[FileKindCount]; ///< last recorded content of each file when capturing
+    ProcessStatus  lastRow;   ///< status written last, only kept if only changes are written
+    TimeSpec       lastRowTS; ///< time of @ref lastRow
+};
+
+/// state required for reading processes, one instance per sampling thread
+class Sampler {
+  public:
+    /// creates a sampler for the given status columns,
+    /// opens a taskstats connection and an io_uring if requested
+    /// @param measure whether to measure read and parse latencies in @ref stats
+    /// @param captureRaw whether to append the raw file contents to @ref recording instead of parsing them
+    /// @param schedStat whether to calculate CPU usage from /proc/pid/schedstat, see @ref ReadPlan
+    Sampler(const std::set<int>& fields, const bool useTaskStats, const bool useUring, const bool showKThreads,
+            const bool measure, const bool captureRaw, const bool schedStat);
+
+    /// reads the given process and updates its status
+    void sample(Process& process);
+
+    /// reads the given processes and updates their status, reads all files
+    /// of all processes in a single batch if io_uring is available
+    /// @note @p count must not exceed @ref batchSize()
+    void sampleBatch(Process* const* processes, const size_t count);
+
+    /// returns the number of processes to pass to @ref sampleBatch() at once
+    size_t batchSize() const;
+
+    /// changes the status columns to read and calculate, the status of processes read before is kept
+    void setFields(const std::set<int>& fields, const bool schedStat);
+
+    /// sets the files to read in the current iteration, indexed by @ref ProcFileKind, all by default
+    void setDue(const bool* tickDue);
+
+    /// sets the system uptime of the current iteration, read once per iteration instead of once per process
+    void setUptime(const double secs) { uptimeSecs = secs; }
+
+    /// updates the status of @p process from recorded file contents,
+    /// @p contents holds a NULL pointer for each file that could not be read
+    void replay(Process& process, const TimeSpec& ts, const std::string* const* contents, const bool* recorded);
+
+    ReadBuffer      buffer;          ///< buffer to read files from /proc into
+    TaskStatsReader taskStats;       ///< taskstats connection, only opened if requested
+    UringReader     uring;           ///< io_uring for batched reads, only opened if requested
+    ReadPlan        plan;            ///< what to read and calculate
+    ReadPlan        threadPlan;      ///< @ref plan for single threads, which share their memory with the process
+    ReadPlan        tickPlan;        ///< @ref plan restricted to the files due in the current iteration
+    ReadPlan        tickThreadPlan;  ///< @ref threadPlan restricted to the files due in the current iteration
+    bool            monitorKThreads; ///< whether to sample kernel threads
+    bool            collectStats;    ///< whether to measure latencies
+    SamplerStats    stats;           ///< read and parse latencies, only if @ref collectStats is set
+    bool            capture;         ///< whether to record raw file contents instead of parsing them
+    std::string     recording;       ///< recorded file contents of the current iteration
+    double          uptimeSecs;      ///< system uptime in seconds of the current iteration, see @ref setUptime()
+
+  private:
+    // not copyable, owns the taskstats connection and io_uring
+    Sampler(const Sampler& other);
+    Sampler& operator=(const Sampler& other);
+
+    /// pointer to one of ProcReader's parse functions
+    typedef void (ProcReader::*ParseFunction)(const char* buf, const ssize_t len);
+
+    /// returns the current time in nanoseconds if latencies are measured, 0 otherwise
+    uint64_t timestamp() const { return collectStats ? nowNsecs() : 0; }
+
+    /// like ProcReader::readAll(), but measures the time spent reading and parsing
+    void readAllTimed(Process& process, ProcReader& pr);
+
+    /// reads the given file and parses it with @p parse, adds the time spent to @p readNs and @p parseNs
+    /// @param read index of the batched read, see @ref batchResult()
+    void readFile(ProcFile& file, const int read, const bool submitted, ProcReader& pr, ParseFunction parse,
+                  uint64_t& readNs, uint64_t& parseNs);
+
+    /// appends the contents of all files of @p process to @ref recording,
+    /// only parses /proc/pid/stat to keep track of the process' threads
+    /// @param reads indices of the batched reads of the process' files, NULL if not read in a batch
+    void captureProcess(Process& process, const int* reads, const bool submitted, const TimeSpec& curTS);
+
+    /// adds a read of @p file to the current io_uring batch
+    /// @return index of the read or -1 if the file has to be read synchronously
+    int queueRead(ProcFile& file);
+
+    /// returns the result of a batched read in @p data and @p len,
+    /// reads the file synchronously if it was not part of the batch (@p read is -1) or the batched read failed
+    void batchResult(ProcFile& file, const int read, const bool submitted, const char*& data, ssize_t& len);
+
+    /// returns the plan of the current iteration for @p process, @ref tickThreadPlan for single threads
+    const ReadPlan& planFor(const Process& process) const { return process.files.thread ? tickThreadPlan : tickPlan; }
+
+    /// updates the status of @p process from @p pr after all files have been read at @p curTS
+    void finish(Process& process, ProcReader& pr, const TimeSpec& curTS);
+
+    bool             due[FileKindCount]; ///< files due in the current iteration, see @ref setDue()
+    std::vector<int> batchReads; ///< indices of the batched reads, @ref filesPerProcess per process
 };
 
 #endif // AUDRIA_H
@@ -9,6 +9,7 @@
 #include <cstdlib>
 #include <cstring>
 
+#include <sys/resource.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <errno.h>
@@ -17,8 +18,7 @@ bool dirExists(const std::string& dir) {
     assert(!dir.empty());
     
     struct stat st;
-    stat(dir.c_str(), &st);
-    return S_ISDIR(st.st_mode);
+    return stat(dir.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
 }
 
 bool fileReadable(const std::string& path) {
@@ -31,8 +31,20 @@ bool isNumber(const std::string& str) {
     return !str.empty() && str.find_first_not_of("0123456789.-") == std::string::npos;
 }
 
+/// directory to read process information from
+static std::string procRootDir = "/proc";
+
+void setProcRoot(const std::string& root) {
+    assert(!root.empty());
+    procRootDir = root;
+}
+
+const std::string& procRoot() {
+    return procRootDir;
+}
+
 double uptime() {
-    static const std::string fileName = "/proc/uptime";
+    const std::string fileName = procRootDir + "/uptime";
     std::ifstream file(fileName.c_str(), std::ifstream::in);
     if (!file.good()) {
         std::cerr << "could not open " << fileName << ": " << strerror(errno) << std::endl;
@@ -55,3 +67,21 @@ long getHertz() {
     assert(hertz > 0);
     return hertz;
 }
+
+unsigned long raiseOpenFileLimit() {
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == -1) {
+        std::cerr << "could not get open file limit: " << strerror(errno) << std::endl;
+        return 0;
+    }
+
+    if (limit.rlim_cur != limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        if (setrlimit(RLIMIT_NOFILE, &limit) == -1) {
+            std::cerr << "could not raise open file limit: " << strerror(errno) << std::endl;
+            getrlimit(RLIMIT_NOFILE, &limit);
+        }
+    }
+
+    return limit.rlim_cur;
+}
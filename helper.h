@@ -43,6 +43,13 @@ std::string numberToString(const T number) {
     return sstr.str();
 }
 
+/// sets the directory to read process information from instead of /proc,
+/// e.g. a copy of /proc or a tree created by audria-procgen
+void setProcRoot(const std::string& root);
+
+/// returns the directory to read process information from, "/proc" by default
+const std::string& procRoot();
+
 /// returns the system uptime in seconds from /proc/uptime
 /// or std::numeric_limits<double>::quiet_NaN() on error
 double uptime();
@@ -53,4 +60,8 @@ double uptime();
 /// htop also uses _SC_CLK_TCK from sysconf().
 long getHertz();
 
+/// raises the soft limit of open files to the hard limit
+/// @return the new soft limit
+unsigned long raiseOpenFileLimit();
+
 #endif // HELPER_H